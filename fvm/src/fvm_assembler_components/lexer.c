@@ -122,6 +122,9 @@ int lexer_run(void) {
 						case 's':
 							shared.sourceInstructions[shared.sourceInstructionsLength - 1].type = STRING;
 							break;
+						case 'p':
+							shared.sourceInstructions[shared.sourceInstructionsLength - 1].type = PACKED_STRING;
+							break;
 						case 'b':
 							shared.sourceInstructions[shared.sourceInstructionsLength - 1].type = BINARY;
 							break;
@@ -168,13 +171,15 @@ int lexer_run(void) {
 				} else {
                    	if(shared.sourceInstructions[shared.sourceInstructionsLength - 1].type == STRING) // Strings take up 1 address per character, so the address after a string should be advanced by the amount of characters in the string
                     	lexer.maxAddress += lexer.rawTextLength;
+                   	else if(shared.sourceInstructions[shared.sourceInstructionsLength - 1].type == PACKED_STRING) // Packed strings take up 1 address per 8 characters, the last one padded with zeroes
+                    	lexer.maxAddress += (lexer.rawTextLength + 7) / 8;
                    	else // Otherwise, it's a single number, so the following token only has to be 1 address along
             				    	lexer.maxAddress++;
 
 					lexer.rawTextLength = 0; // Reset this for the next literal to come around!
 				}
 			}
-		} else { // Otherwise, continue to count the amount of characters in the current literal
+		} else if(lexer.source[i] != '\\') { // Otherwise, continue to count the amount of characters in the current literal (backslashes starting escape sequences don't end up in it)
 			lexer.rawTextLength++;
 		}
 
@@ -12,7 +12,7 @@ extern struct fvma_lexer { // These are intended as variables, so will be writte
     size_t maxAddress, // Address used to provide parser with the address of each token in the output
            textBuffSize, // Number of chars allocated to textBuff
            textBuffLength, // No. characters stored in textBuff (discluding \0)
-           rawTextLength, // No. raw chars read from recently inputted literal
+           rawTextLength, // No. raw chars read from recently inputted literal, not counting backslashes
            operands; // Number of operands possessed by last instruction token, so that it can be known not to check for instruction tokens if given tokens are in the places of an instruction's operands
     char *source, // Raw source code from input file;
          *textBuff; // Buffer for the text of the current token to be put into the sourceInstructions array;
@@ -10,6 +10,7 @@
 
 struct fvma_parser parser = {
     .nextValue = 0,
+    .packedLength = 0,
     .labelTableSize = ALLOC_SIZE,
     .labelTableLength = NO_DEFAULT_LABELS
 };
@@ -73,7 +74,7 @@ int parser_run(void) {
     				break;
     			case '=': // If it represents a numeric value
     				if(i + 1 < shared.sourceInstructionsLength) {
-    					if(shared.sourceInstructions[i + 1].type == STRING) {
+    					if(shared.sourceInstructions[i + 1].type == STRING || shared.sourceInstructions[i + 1].type == PACKED_STRING) {
     						fprintf(stderr,
     								"fvma -> Line %zu: You can't assign a label to a string: labels can only represent addresses or single values\n",
     								shared.sourceInstructions[i].line);
@@ -133,9 +134,11 @@ int parser_run(void) {
     			break;
 
     		case STRING: // If it's a string
-    			shared.sourceInstructions[i].text[shared.sourceInstructions[i].text_length -= 2] = '\0'; // Get rid of the "]s" at the end
+    		case PACKED_STRING: // (Or a packed one, which goes 8 characters to a cell, starting from the least significant byte)
+    			shared.sourceInstructions[i].text[shared.sourceInstructions[i].text_length -= 2] = '\0'; // Get rid of the "]s" (or "]p") at the end
 
     			parser.escape = false;
+    			parser.packedLength = 0;
 
     			for(size_t j = 0; j < shared.sourceInstructions[i].text_length; j++) { // Go through each character of the string
     				if(shared.sourceInstructions[i].text[j] == '\\') { // If it's a backslash ignore it
@@ -161,6 +164,11 @@ int parser_run(void) {
     					parser.escape = false; // The escape sequence is complete
     				}
 
+    				if(shared.sourceInstructions[i].type == PACKED_STRING && parser.packedLength++ % 8) { // If it's packed and the last cell has room, put the character in the next byte up of it
+    					shared.output[shared.outputLength - 1] |= (uint64_t)(unsigned char)shared.sourceInstructions[i].text[j] << (parser.packedLength - 1) % 8 * 8;
+    					continue;
+    				}
+
     				if(++shared.outputLength > shared.outputSize) { // If the output buffer needs more space allocating to accomodate the next character of the string
     					shared.outputSize += ALLOC_SIZE;
 
@@ -184,7 +192,10 @@ int parser_run(void) {
     					shared.output = (uint64_t *)shared.allocBuff;
     				}
 
-    				shared.output[shared.outputLength - 1] = shared.sourceInstructions[i].text[j]; // Send each character of the string to the output buffer
+    				if(shared.sourceInstructions[i].type == PACKED_STRING) // Start a new cell with it if it's packed
+    					shared.output[shared.outputLength - 1] = (unsigned char)shared.sourceInstructions[i].text[j];
+    				else // Otherwise, send each character of the string to the output buffer
+    					shared.output[shared.outputLength - 1] = shared.sourceInstructions[i].text[j];
     			}
     			
     			continue;
@@ -9,7 +9,8 @@ extern struct fvma_parser { // These are intended as variables, so will be writt
          labelWasFound, // If the label being called upon exists in the Label Table
          escape; // When processing the characters of a string literal, was an escape-sequence initiated?
     uint64_t nextValue; // the next value to be written to the output buffer
-    size_t labelTableSize, // Number of struct labels allocated to the Label Table
+    size_t packedLength, // No. characters of the packed string being processed that have been put into the output buffer
+           labelTableSize, // Number of struct labels allocated to the Label Table
            labelTableLength; // Amount of labels stored in the Label Table
 } parser;
 
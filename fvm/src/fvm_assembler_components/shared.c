@@ -59,6 +59,9 @@ const struct label DEFAULT_LABELS[NO_DEFAULT_LABELS] = {
 	{"mem", 0},
 	{"inp", 1},
 	{"out", 2},
+	{"alc", 4},
+	{"blk", 5},
+	{"byt", 6},
 
 	{"mch", 0},
 	{"mar", 1},
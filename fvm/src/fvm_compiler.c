@@ -0,0 +1,319 @@
+/* Fox Virtual Machine: Ahead-of-time Compiler
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// Translates a ROM into C, which is built against the runtime components (see fvm_runtime_components/aot.h) into a native executable:
+
+#include "fvm_runtime_components/global.h"
+#include "fvm_runtime_components/decoder.h"
+
+#include <string.h>
+
+#define FVMC_DEFAULT_OUTPUT "a.c" // File written to if no output is given
+
+static const char *REGISTER_EXPRESSIONS[NO_REGISTERS] = { // How the translation refers to each register (CEA is only known at compile time, so it's handled separately)
+    [MCH] = "fvm_registers[MCH]",
+    [MAR] = "fvm_registers[MAR]",
+    [MDR] = "fvm_registers[MDR]",
+    [ACC] = "acc",
+    [DAT] = "dat",
+    [CEA] = NULL,
+    [CSP] = "fvm_registers[CSP]",
+    [GP0] = "fvm_registers[GP0]",
+    [GP1] = "fvm_registers[GP1]",
+    [GP2] = "fvm_registers[GP2]",
+    [GP3] = "fvm_registers[GP3]",
+    [GP4] = "fvm_registers[GP4]",
+    [GP5] = "fvm_registers[GP5]",
+    [GP6] = "fvm_registers[GP6]",
+    [GP7] = "fvm_registers[GP7]"
+};
+
+static const char *ALU_STATEMENTS[DECODED_ACCUMULATOR_NE - DECODED_ACCUMULATOR_ADD + 1] = { // C for each ALU operation, in the same order as their decoded ops
+    "acc += dat;",
+    "acc -= dat;",
+    "acc = ~acc;",
+    "acc++;",
+    "acc--;",
+    "acc *= dat;",
+    "acc /= dat;",
+    "acc &= dat;",
+    "acc |= dat;",
+    "acc ^= dat;",
+    "acc <<= dat;",
+    "acc >>= dat;",
+    "acc = acc > dat;",
+    "acc = acc < dat;",
+    "acc = acc >= dat;",
+    "acc = acc <= dat;",
+    "acc = acc == dat;",
+    "acc = acc != dat;"
+};
+
+static _Bool compile_rom(const char *path) { // Load the ROM at path into Main Memory, as the runtime would
+    FILE *f;
+    long bytes;
+
+    if((f = fopen(path, "rb")) == NULL) {
+        perror("fvmc -> Could not access ROM");
+
+        return 1;
+    }
+
+    fseek(f, 0, SEEK_END);
+
+    bytes = ftell(f);
+
+    rewind(f);
+
+    if(bytes <= 0) {
+        fprintf(stderr, "fvmc -> Found ROM to be empty!\n");
+
+        fclose(f);
+
+        return 1;
+    }
+
+    files[MEM].size = files[MEM].length = (bytes >> 3) + (_Bool)(bytes % 8);
+
+    if((files[MEM].self = calloc(files[MEM].size, sizeof(uint64_t))) == NULL) {
+        perror("fvmc -> Could not allocate memory for ROM");
+
+        fclose(f);
+
+        return 1;
+    }
+
+    fread(files[MEM].self, files[MEM].size, sizeof(uint64_t), f);
+
+    fclose(f);
+
+    return 0;
+}
+
+static void compile_register_write(FILE *out, uint8_t reg, const char *value) { // Emit reg = value, where writing CEA is a computed jump
+    if(reg == CEA)
+        fprintf(out, "AOT_MOVE_TO_CEA(%s);\n", value);
+    else
+        fprintf(out, "%s = %s;\n", REGISTER_EXPRESSIONS[reg], value);
+}
+
+static _Bool compile_instruction(FILE *out, uint64_t address, struct decoded_instruction *slot) { // Emit C for the instruction at address, returns 1 if execution never carries on to the next instruction
+    char value[32];
+
+    fprintf(out, "address_%zu: ", address);
+
+    switch(slot->op) {
+        case DECODED_PLACE:
+        case DECODED_PLACE_ACC:
+        case DECODED_PLACE_DAT:
+            snprintf(value, sizeof(value), "UINT64_C(%zu)", slot->operand);
+            compile_register_write(out, slot->reg[0], value);
+
+            return 0;
+        case DECODED_PLACE_CEA: // Verified, so this is always a jump to a translated instruction
+            fprintf(out, "AOT_JUMP(%zu);\n", slot->operand + 3);
+
+            return 1;
+        case DECODED_MOVE:
+        case DECODED_MOVE_TO_ACC:
+        case DECODED_MOVE_FROM_ACC:
+        case DECODED_MOVE_ANY:
+            if(slot->reg[0] == CEA) // Moving out of CEA gives the address of the mv
+                snprintf(value, sizeof(value), "UINT64_C(%zu)", address);
+            else
+                snprintf(value, sizeof(value), "%s", REGISTER_EXPRESSIONS[slot->reg[0]]);
+
+            compile_register_write(out, slot->reg[1], value);
+
+            return slot->reg[1] == CEA;
+        case DECODED_STORE:
+            fprintf(out, "AOT_STORE(%zu);\n", address);
+
+            return 0;
+        case DECODED_LOAD:
+            fprintf(out, "AOT_LOAD(%zu);\n", address);
+
+            return 0;
+        case DECODED_JUMP:
+            fprintf(out, "AOT_JUMP(%zu);\n", slot->operand);
+
+            return 1;
+        case DECODED_JUMP_IF_SET:
+            fprintf(out, "if(acc) AOT_JUMP(%zu);\n", slot->operand);
+
+            return 0;
+        case DECODED_JUMP_IF_CLEAR:
+            fprintf(out, "if(!acc) AOT_JUMP(%zu);\n", slot->operand);
+
+            return 0;
+        case DECODED_CALL:
+            fprintf(out, "AOT_CALL(%zu, %zu);\n", address, slot->operand);
+
+            return 1;
+        case DECODED_RETURN:
+            fprintf(out, "AOT_RETURN(%zu);\n", address);
+
+            return 1;
+        case DECODED_FINISH:
+            fprintf(out, "AOT_FINISH(%zu);\n", address);
+
+            return 1;
+        default: // The ALU operations
+            fprintf(out, "%s\n", ALU_STATEMENTS[slot->op - DECODED_ACCUMULATOR_ADD]);
+
+            return 0;
+    }
+}
+
+static _Bool compile(FILE *out, const char *source) { // Emit the translation of everything decoded in Main Memory
+    uint64_t *code,
+             code_length = (files[MEM].length >> 6) + 1,
+             previous = 0;
+    _Bool ended = 1;
+
+    if((code = calloc(code_length, sizeof(uint64_t))) == NULL) {
+        perror("fvmc -> Could not allocate memory for code bitmap");
+
+        return 1;
+    }
+
+    fprintf(out,
+            "/* Translated from %s by fvmc. Build it with the runtime components (see fvm_runtime_components/aot.h). */\n\n"
+            "#include \"fvm_runtime_components/aot.h\"\n\n"
+            "#pragma GCC diagnostic ignored \"-Wunused-label\" // Not every instruction is jumped to\n\n"
+            "static const uint64_t rom[%zu] = {",
+            source, files[MEM].length);
+
+    for(uint64_t i = 0; i < files[MEM].length; i++)
+        fprintf(out, "%sUINT64_C(%zu)", i % 8 ? ", " : (i ? ",\n    " : "\n    "), files[MEM].self[i]);
+
+    fprintf(out, "\n};\n\nstatic void run(void) {\n    uint64_t cea = 0, acc = 0, dat = 0;\n\n    goto address_0;\n\n");
+
+    for(uint64_t address = 0; address < files[MEM].length; address++) { // Every instruction that was reached in verification, in order
+        if(decoder.code[address].op == DECODED_UNDECODED)
+            continue;
+
+        if(!ended && previous != address) // Instructions don't always follow each other in memory
+            fprintf(out, "goto address_%zu;\n", previous);
+
+        for(uint64_t i = address; i < address + decoder.code[address].length; i++)
+            code[i >> 6] |= (uint64_t)1 << (i & 63);
+
+        ended = compile_instruction(out, address, &decoder.code[address]);
+        previous = address + decoder.code[address].length;
+    }
+
+    fprintf(out, "\ndispatch: // Computed jumps land here, going to the instruction at cea if it was translated\n    AOT_TICK();\n\n    switch(cea) {\n");
+
+    for(uint64_t address = 0; address < files[MEM].length; address++)
+        if(decoder.code[address].op != DECODED_UNDECODED)
+            fprintf(out, "        case %zu: goto address_%zu;\n", address, address);
+
+    fprintf(out,
+            "    }\n\n"
+            "interpret: // Anywhere else, or anything after translated code was written over, is run by the interpreter\n"
+            "    aot_interpret(cea, acc, dat);\n\n"
+            "    return;\n\n"
+            "graphics_error:\n"
+            "    fprintf(stderr, \"fvmr -> Graphics library encountered an error.\\n\");\n\n"
+            "    fvmr_exit_code = FVMR_EXIT_FAILURE_GRAPHICS_LIB;\n\n"
+            "    goto end;\n\n"
+            "keyboard_error:\n"
+            "    fprintf(stderr, \"fvmr -> Keyboard library encountered an error.\\n\");\n\n"
+            "    fvmr_exit_code = FVMR_EXIT_FAILURE_KEYBOARD_LIB;\n\n"
+            "    goto end;\n\n"
+            "error:\n"
+            "    fvmr_exit_code = FVMR_EXIT_FAILURE_EXECUTION;\n\n"
+            "end:\n"
+            "    fvm_registers[CEA] = cea;\n"
+            "    fvm_registers[ACC] = acc;\n"
+            "    fvm_registers[DAT] = dat;\n"
+            "}\n\n"
+            "static const uint64_t code[%zu] = {",
+            code_length);
+
+    for(uint64_t i = 0; i < code_length; i++)
+        fprintf(out, "%sUINT64_C(%zu)", i % 8 ? ", " : (i ? ",\n    " : "\n    "), code[i]);
+
+    fprintf(out, "\n};\n\nstatic const struct aot_program program = {\n    .source = \"");
+
+    for(const char *c = source; *c; c++) // Escape the path for the string literal
+        fprintf(out, *c == '"' || *c == '\\' ? "\\%c" : "%c", *c);
+
+    fprintf(out,
+            "\",\n"
+            "    .rom = rom,\n"
+            "    .code = code,\n"
+            "    .length = %zu,\n"
+            "    .run = run\n"
+            "};\n\n"
+            "int main(void) {\n"
+            "    return aot_main(&program);\n"
+            "}\n",
+            files[MEM].length);
+
+    free(code);
+
+    return 0;
+}
+
+int main(int argc, char **argv) { // Entry point:
+    const char *output = FVMC_DEFAULT_OUTPUT;
+    size_t length;
+    FILE *out;
+    _Bool failed;
+
+    if(argc < 2 || argc > 3) {
+        fprintf(stderr, "fvmc -> Usage: %s <rom.fb> [output.c]\n", argv[0]);
+
+        return FVMR_EXIT_FAILURE_ARGUMENTS;
+    }
+
+    if(argc == 3) {
+        if((length = strlen(argv[2])) < 2 || strcmp(argv[2] + length - 2, ".c")) {
+            fprintf(stderr, "fvmc -> Output filename does not end with '.c'\n");
+
+            return FVMR_EXIT_FAILURE_ARGUMENTS;
+        }
+
+        output = argv[2];
+    }
+
+    if(compile_rom(argv[1]))
+        return FVMR_EXIT_FAILURE_INITIAL_FILE_ACCESS;
+
+    decoder.fuse = decoder.quicken = 0; // The translation only needs each instruction on its own
+
+    if(decoder_init(1)) { // Only verified ROMs are translated, so that every jump lands on a label
+        free(files[MEM].self);
+
+        decoder_end();
+
+        return FVMR_EXIT_FAILURE_VERIFICATION;
+    }
+
+    if((out = fopen(output, "w")) == NULL) {
+        perror("fvmc -> Could not open output file");
+
+        free(files[MEM].self);
+
+        decoder_end();
+
+        return FVMR_EXIT_FAILURE_INITIAL_FILE_ACCESS;
+    }
+
+    failed = compile(out, argv[1]);
+
+    fclose(out);
+
+    free(files[MEM].self);
+
+    decoder_end();
+
+    return failed ? FVMR_EXIT_FAILURE_INITIAL_ALLOCATION : FVMR_EXIT_SUCCESS;
+}
@@ -10,9 +10,210 @@
 #include "fvm_runtime_components/instructions.h"
 #include "fvm_runtime_components/fvmgl.h"
 #include "fvm_runtime_components/fvmkbd.h"
+#include "fvm_runtime_components/options.h"
+#include "fvm_runtime_components/threaded.h"
+#include "fvm_runtime_components/block.h"
+#include "fvm_runtime_components/jit.h"
+#include "fvm_runtime_components/cache.h"
+#include "fvm_runtime_components/pinned.h"
+#include "fvm_runtime_components/scheduler.h"
+#include "fvm_runtime_components/forkserver.h"
+#include "fvm_runtime_components/checkpoint.h"
+#include "fvm_runtime_components/budget.h"
+#include "fvm_runtime_components/headless.h"
+#include "fvm_runtime_components/paged.h"
+#include "fvm_runtime_components/quota.h"
+#include "fvm_runtime_components/heap.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static void run(void) { // Run the ROM from CEA on the engine that was asked for, within any budget it was given
+    budget_init(fvmr_options.max_instructions, fvmr_options.max_seconds);
+    fvmgl_poll_init(fvmr_options.poll_every, fvmr_options.poll_interval);
+
+    switch(fvmr_options.engine) {
+        case FVMR_ENGINE_TABLE:
+            table_run();
+            break;
+        case FVMR_ENGINE_PINNED:
+            pinned_run(UINT64_MAX);
+            break;
+        case FVMR_ENGINE_THREADED:
+            threaded_run();
+            break;
+        case FVMR_ENGINE_BLOCK:
+        case FVMR_ENGINE_JIT:
+            block_run();
+    }
+
+    fvmgl_poll_end();
+    budget_end();
+}
+
+static void huge_pages_advise(void) { // Ask for Main Memory to be backed with transparent huge pages, which only warns if it can't be
+    uintptr_t start = ((uintptr_t)files[MEM].self + 4095) & ~(uintptr_t)4095, // (A checkpoint's Main Memory is on the heap, so it may not start on a page)
+              end = ((uintptr_t)(files[MEM].self + files[MEM].size)) & ~(uintptr_t)4095;
+
+    if(end > start && madvise((void *)start, end - start, MADV_HUGEPAGE))
+        perror("fvmr -> Warning, could not use transparent huge pages for Main Memory");
+}
+
+static _Bool rom_load_huge(int fd, uint64_t bytes, uint64_t cells) { // Read the ROM of bytes from fd into Main Memory made of explicit huge pages, enough for the Main Memory limit (or just the ROM, without one), returns 1 (setting fvmr_exit_code) on failure
+    uint64_t reserved = fvmr_options.max_memory != UINT64_MAX && fvmr_options.max_memory > cells ? fvmr_options.max_memory : cells,
+             read_in;
+    ssize_t got;
+    void *memory;
+
+    if(reserved > (SIZE_MAX - FVM_HUGE_PAGE) / sizeof(uint64_t)) {
+        fprintf(stderr, "fvmr -> Main Memory limit is too large to back with huge pages\n");
+
+        close(fd);
+
+        fvmr_exit_code = FVMR_EXIT_FAILURE_INITIAL_ALLOCATION;
+
+        return 1;
+    }
+
+    reserved = ((reserved * sizeof(uint64_t) + FVM_HUGE_PAGE - 1) & ~(FVM_HUGE_PAGE - 1)) / sizeof(uint64_t); // Filling out its last huge page
+
+    if((memory = mmap(NULL, reserved * sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0)) == MAP_FAILED) { // Without MAP_NORESERVE, so that there being too few huge pages fails here, rather than when they're touched
+        perror("fvmr -> Could not allocate huge pages for Main Memory");
+
+        close(fd);
+
+        fvmr_exit_code = FVMR_EXIT_FAILURE_INITIAL_ALLOCATION;
+
+        return 1;
+    }
+
+    for(read_in = 0; read_in < bytes; read_in += got) {
+        if((got = pread(fd, (char *)memory + read_in, bytes - read_in, read_in)) <= 0) {
+            if(!got)
+                errno = EIO; // (The ROM shrank since it was looked at)
+
+            perror("fvmr -> Could not read ROM");
+
+            munmap(memory, reserved * sizeof(uint64_t));
+            close(fd);
+
+            fvmr_exit_code = FVMR_EXIT_FAILURE_INITIAL_FILE_ACCESS;
+
+            return 1;
+        }
+    }
+
+    close(fd);
+
+    files[MEM] = (struct fvm_file){.self = (uint64_t *)memory, .size = reserved, .length = cells, .mapped = reserved};
+
+    return 0;
+}
+
+static _Bool rom_load(const char *path) { // Map the ROM at path as the start of Main Memory, returns 1 (setting fvmr_exit_code) on failure
+    struct stat status;
+    uint64_t cells,
+             reserved;
+    void *memory;
+    int fd;
+
+    if((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &status)) { // Try to open ROM file
+        perror("fvmr -> Could not access ROM");
+
+        if(fd >= 0)
+            close(fd);
+
+        fvmr_exit_code = FVMR_EXIT_FAILURE_INITIAL_FILE_ACCESS;
+
+        return 1;
+    }
+
+    cells = (status.st_size >> 3) + (_Bool)(status.st_size % 8); // Divide its size by 8 (and add one in the case of unclean divide), since it's in bytes, not qwords
+
+    if(!cells) { // Check if ROM is empty and don't continue if it is
+        fprintf(stderr, "fvmr -> Found ROM to be empty!\n");
+
+        close(fd);
+
+        fvmr_exit_code = FVMR_EXIT_FAILURE_EXECUTION;
+
+        return 1;
+    }
+
+    if(fvmr_options.huge_pages == FVMR_HUGE_PAGES_EXPLICIT) // Huge pages from the pool can't be mapped from a file, so the ROM is copied in
+        return rom_load_huge(fd, status.st_size, cells);
+
+    // Main Memory is anonymous memory, which costs nothing until it's touched, reserved for it to grow into in place,
+    // with the ROM mapped copy-on-write over the start of it, so that its pages are only read in as they're used:
+
+    reserved = cells > FVM_ROM_RESERVE ? cells : FVM_ROM_RESERVE;
+
+    if((memory = mmap(NULL, reserved * sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)) == MAP_FAILED
+       && (memory = mmap(NULL, (reserved = cells) * sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)) == MAP_FAILED) { // Without the room to grow, if there isn't the address space for it
+        perror("fvmr -> Could not allocate memory for Main Memory");
+
+        close(fd);
+
+        fvmr_exit_code = FVMR_EXIT_FAILURE_INITIAL_ALLOCATION;
+
+        return 1;
+    }
+
+    if(mmap(memory, status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        perror("fvmr -> Could not map ROM");
+
+        munmap(memory, reserved * sizeof(uint64_t));
+        close(fd);
 
-int main(void) { // Entry point:
-	FILE *f;
+        fvmr_exit_code = FVMR_EXIT_FAILURE_INITIAL_FILE_ACCESS;
+
+        return 1;
+    }
+
+    close(fd); // The mapping keeps the ROM open
+
+    files[MEM] = (struct fvm_file){.self = (uint64_t *)memory, .size = reserved, .length = cells, .mapped = reserved};
+
+    if(fvmr_options.huge_pages == FVMR_HUGE_PAGES_TRANSPARENT) // For the pages the ROM grows into (its own pages stay those of the file, until they're written to)
+        huge_pages_advise();
+
+    return 0;
+}
+
+int main(int argc, char **argv) { // Entry point:
+    struct timespec start, finish;
+
+    if(options_parse(argc, argv)) // Read the command line before acquiring anything
+        return FVMR_EXIT_FAILURE_ARGUMENTS;
+
+    console_input = stdin;
+    console_output = stdout;
+
+    if(fvmr_options.batch != NULL) { // Run the guests in the batch file on the scheduler instead of the ROM, without a screen or keyboard
+        if(scheduler_init(fvmr_options.batch, fvmr_options.max_memory, fvmr_options.max_callstack)) {
+            scheduler_end();
+
+            return FVMR_EXIT_FAILURE_INITIAL_FILE_ACCESS;
+        }
+
+        if(scheduler_run(fvmr_options.workers, fvmr_options.quantum)) {
+            scheduler_end();
+
+            return FVMR_EXIT_FAILURE_INITIAL_ALLOCATION;
+        }
+
+        scheduler_report();
+
+        fvmr_exit_code = scheduler.failed ? FVMR_EXIT_FAILURE_EXECUTION : FVMR_EXIT_SUCCESS;
+
+        scheduler_end();
+
+        return fvmr_exit_code;
+    }
 
     if((files[CST] = (struct fvm_file){.self = calloc(ALLOC_SIZE, sizeof(uint64_t)), .size = ALLOC_SIZE, .length = 0}).self == NULL) { // Try to initialise Callstack
         perror("fvmr -> Could not allocate memory for Callstack");
@@ -20,129 +221,213 @@ int main(void) { // Entry point:
         return FVMR_EXIT_FAILURE_INITIAL_ALLOCATION;
     }
 
-	if((f = fopen(FVM_ROM, "rb")) == NULL) { // Try to open ROM file
-		perror("fvmr -> Could not access ROM");
-
+    if(fvmr_options.resume != NULL ? checkpoint_resume(fvmr_options.resume) : rom_load(fvmr_options.rom)) { // Load Main Memory from the checkpoint being resumed, or the ROM
         free(files[CST].self);
 
-		return FVMR_EXIT_FAILURE_INITIAL_FILE_ACCESS;
-	}	
+        paged_end(&paged);
+        checkpoint_end();
 
-    // Get size of ROM:
+        return fvmr_options.resume != NULL ? FVMR_EXIT_FAILURE_INITIAL_FILE_ACCESS : fvmr_exit_code;
+    }
 
-	files[MEM].size = 0;
+    if(fvmr_options.resume != NULL && fvmr_options.huge_pages == FVMR_HUGE_PAGES_TRANSPARENT)
+        huge_pages_advise();
 
-	while(fgetc(f) != EOF)
-        files[MEM].size++;
+    quota_init(fvmr_options.max_memory, fvmr_options.max_callstack); // Counting from whatever the checkpoint already had on the Callstack
 
-	rewind(f); // Go back to beginning of file once number of bytes has been counted
+    if(fvmr_options.fork_server != NULL) { // Run up to the snapshot before anything is decoded, so that the jobs decode Main Memory as the snapshot left it, from its CEA and the return addresses on its Callstack rather than from address 0
+        if(fork_server_init(fvmr_options.fork_server)) {
+            free(files[CST].self);
+            file_free(&files[MEM]);
 
-    files[MEM].size = (files[MEM].size >> 3) + (_Bool)(files[MEM].size % 8); // Divide it by 8 (and add one in the case of unclean divide), since fgetc() counts bytes, not qwords
+            paged_end(&paged);
+            fork_server_end();
 
-	files[MEM].length = files[MEM].size;
+            return FVMR_EXIT_FAILURE_INITIAL_FILE_ACCESS;
+        }
 
-    if(!files[MEM].length) { // Check if ROM is empty and don't continue if it is
-        fprintf(stderr, "fvmr -> Found ROM to be empty!\n");
+        if((disk = fopen(FVM_DISK, "rb+")) == NULL) {
+            perror("fvmr -> Could not access Disk");
 
-        free(files[CST].self);
+            free(files[CST].self);
+            file_free(&files[MEM]);
+
+            paged_end(&paged);
+            fork_server_end();
+
+            return FVMR_EXIT_FAILURE_INITIAL_FILE_ACCESS;
+        }
+
+        if(fork_server_snapshot(fvmr_options.snapshot_after, fvmr_options.snapshot_at)) {
+            if(fvmr_exit_code != FVMR_EXIT_SUCCESS)
+                traceback();
+
+            free(files[CST].self);
+            file_free(&files[MEM]);
 
-        fclose(f);
+            paged_end(&paged);
+            fork_server_end();
 
-        return FVMR_EXIT_FAILURE_EXECUTION;
+            fclose(disk);
+
+            return fvmr_exit_code;
+        }
     }
 
-	if((files[MEM].self = calloc(files[MEM].size, sizeof(uint64_t))) == NULL) { // Attempt to allocate space for Main Memory to contain ROM 
-		perror("fvmr -> Could not allocate memory for Main Memory");
+    decoder.fuse = fvmr_options.fusion;
+    decoder.quicken = fvmr_options.quickening;
 
-        free(files[CST].self);
+    if(fvmr_options.engine != FVMR_ENGINE_TABLE && fvmr_options.engine != FVMR_ENGINE_PINNED && cache_load(fvmr_options.cache)) { // Decode the ROM ahead of time for the engines that run it decoded, unless it was done on an earlier run
+        if(decoder_init(0)) {
+            free(files[CST].self);
+            file_free(&files[MEM]);
 
-		fclose(f);
+            paged_end(&paged);
+            decoder_end();
+            cache_end();
+            checkpoint_end();
 
-		return FVMR_EXIT_FAILURE_INITIAL_ALLOCATION;
-	}
+            fork_server_end();
 
-	fread(files[MEM].self, files[MEM].size, sizeof(uint64_t), f); // Load ROM into Main Memory
+            if(disk != NULL) // Opened early for the fork server
+                fclose(disk);
 
-	fclose(f); // Close ROM
+            return FVMR_EXIT_FAILURE_INITIAL_ALLOCATION; // (Which is the only way that decoding ahead of time can fail)
+        }
 
-    if((disk = fopen(FVM_DISK, "rb+")) == NULL) { // Try to open Secondary Storage for runtime
-        perror("fvmr -> Could not access Disk");
+        cache_keep();
+    }
 
+    if((fvmr_options.engine == FVMR_ENGINE_BLOCK || fvmr_options.engine == FVMR_ENGINE_JIT) && block_init()) { // Set up the block cache for the engines that run blocks
         free(files[CST].self);
-        free(files[MEM].self);
+        file_free(&files[MEM]);
 
-        return FVMR_EXIT_FAILURE_INITIAL_FILE_ACCESS;
+        paged_end(&paged);
+        decoder_end();
+        cache_end();
+        block_end();
+        checkpoint_end();
+
+        fork_server_end();
+
+        if(disk != NULL) // Opened early for the fork server
+            fclose(disk);
+
+        return FVMR_EXIT_FAILURE_INITIAL_ALLOCATION;
     }
 
-    // Initialise Graphics API et al:
+    if(fvmr_options.engine == FVMR_ENGINE_JIT) // Blocks are still run without translations if native code can't be generated
+        jit_init(fvmr_options.perf_map);
 
-    if(fvmgl_init()) { // Initialise fvmgl
-        fprintf(stderr, "fvmr -> Graphics API -> Failed to initialise.\n");
+    if(disk == NULL && (disk = fopen(FVM_DISK, "rb+")) == NULL) { // Try to open Secondary Storage for runtime, unless the fork server already has
+        perror("fvmr -> Could not access Disk");
 
         free(files[CST].self);
-        free(files[MEM].self);
+        file_free(&files[MEM]);
 
-        fclose(disk);
+        paged_end(&paged);
+        decoder_end();
+        cache_end();
+        block_end();
+        jit_end();
+        checkpoint_end();
 
-        fvmgl_end();
-
-        return FVMR_EXIT_FAILURE_GRAPHICS_LIB;
+        return FVMR_EXIT_FAILURE_INITIAL_FILE_ACCESS;
     }
 
-    if(fvmkbd_init(fvmgl_screen_object.window)) { // Initialise fvmkbd
-        fprintf(stderr, "fvmr -> Keyboard API -> Failed to initialise.\n");
+    if(fvmr_options.fork_server != NULL) { // Serve the jobs from the snapshot, without a screen or keyboard
+        if(fork_server_run(fvmr_options.workers, run))
+            fvmr_exit_code = FVMR_EXIT_FAILURE_INITIAL_ALLOCATION;
+        else
+            fvmr_exit_code = fork_server.failed ? FVMR_EXIT_FAILURE_EXECUTION : FVMR_EXIT_SUCCESS;
+
+        fork_server_report();
 
         free(files[CST].self);
-        free(files[MEM].self);
+        file_free(&files[MEM]);
 
-        fclose(disk);
+        paged_end(&paged);
+        decoder_end();
+        cache_end();
+        block_end();
+        jit_end();
+        fork_server_end();
 
-        fvmgl_end();
+        fclose(disk);
 
-        return FVMR_EXIT_FAILURE_KEYBOARD_LIB;
+        return fvmr_exit_code;
     }
 
-    // Begin execution:
+    // Graphics API et al are only initialised once the ROM first uses the screen buffer or keyboard, so that a ROM that never does doesn't wait on a window being made:
 
-	for(fvm_registers[CEA] = 0; files[MEM].self[fvm_registers[CEA]] != 27; fvm_registers[CEA]++) { // Traverse instructions until instruction 27 (fi - finish) is encountered
-		if(files[MEM].self[fvm_registers[CEA]] >= NO_INSTRUCTIONS) { // If a number is encountered that should be an instruction but isn't in the instructions list
-			fprintf(stderr, "fvmr -> Encountered unknown instruction '%zu'\n", files[MEM].self[fvm_registers[CEA]]);
+    fvmgl_screen_object.deferred = 1;
 
-			fvmr_exit_code = FVMR_EXIT_FAILURE_EXECUTION;
+#ifdef FVMR_HEADLESS
+    if(fvmr_options.resume == NULL && headless_init(fvmr_options.keyboard)) { // A checkpoint already has whatever was left of the keyboard file in its keypress queue
+        free(files[CST].self);
+        file_free(&files[MEM]);
 
-			break;
-		}
+        paged_end(&paged);
+        decoder_end();
+        cache_end();
+        block_end();
+        jit_end();
+        checkpoint_end();
 
-        if(instructions[files[MEM].self[fvm_registers[CEA]]]()) { // Otherwise, try to execute the current instruction. If it returns a failed status, exit safely
-			fvmr_exit_code = FVMR_EXIT_FAILURE_EXECUTION;
+        fclose(disk);
 
-			break;
-		}
+        fvmkbd_end();
 
-		if(fvmgl_tick()) {
-		    fprintf(stderr, "fvmr -> Graphics library encountered an error.\n");
+        return FVMR_EXIT_FAILURE_INITIAL_FILE_ACCESS;
+    }
+#endif
 
-            fvmr_exit_code = FVMR_EXIT_FAILURE_GRAPHICS_LIB;
+    checkpoint_resume_devices(); // Nothing to do unless resuming
 
-            break;
-		}
+    if(fvmr_options.checkpoint != NULL)
+        checkpoint_init(fvmr_options.checkpoint, fvmr_options.checkpoint_every);
+
+    // Begin execution:
 
-		if(fvmkbd_tick()) {
-		    fprintf(stderr, "fvmr -> Keyboard library encountered an error.\n");
+    clock_gettime(CLOCK_MONOTONIC, &start);
 
-		    fvmr_exit_code = FVMR_EXIT_FAILURE_KEYBOARD_LIB;
+    run();
 
-		    break;
-		}
-	}
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+
+    fvmr_stats.seconds = (finish.tv_sec - start.tv_sec) + (finish.tv_nsec - start.tv_nsec) / 1e9;
 
     if(fvmr_exit_code != FVMR_EXIT_SUCCESS) // Produce a traceback if there were errors
         traceback();
 
+    cache_save();
+
+    if(fvmr_options.stats) { // Report statistics if they were asked for
+        stats_report();
+        decoder_report();
+        cache_report();
+        block_report();
+        jit_report();
+        checkpoint_report();
+        paged_report();
+        quota_report();
+        heap_report();
+#ifdef FVMR_HEADLESS
+        headless_report();
+#endif
+    }
+
     // Cleanup:
 
     free(files[CST].self);
-    free(files[MEM].self);
+    file_free(&files[MEM]);
+
+    paged_end(&paged);
+    decoder_end();
+    cache_end();
+    block_end();
+    jit_end();
+    checkpoint_end();
 
     fclose(disk);
 
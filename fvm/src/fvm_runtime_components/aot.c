@@ -0,0 +1,136 @@
+/* Fox Virtual Machine: Runtime support for ROMs translated ahead of time
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "aot.h"
+
+const struct aot_program *aot_program = NULL;
+uint64_t aot_jumps = 0;
+
+enum aot_store_result aot_store(void) { // st through store(), saying if it wrote over translated code
+    if(store())
+        return AOT_STORE_FAILED;
+
+    switch(fvm_registers[MCH]) {
+        case MEM:
+            return aot_is_code(fvm_registers[MAR]) ? AOT_STORE_MODIFIED : AOT_STORE_DONE;
+        case INP:
+        case OUT: // Some screen buffer commands write their results back into the cells after them
+            if(fvm_registers[MAR] == 2 && (aot_is_code(fvm_registers[MDR] + 1) || aot_is_code(fvm_registers[MDR] + 2)))
+                return AOT_STORE_MODIFIED;
+
+            break;
+        case BYT:
+            return aot_is_code(fvm_registers[MAR] >> 3) ? AOT_STORE_MODIFIED : AOT_STORE_DONE;
+        case BLK: // A copy or fill can cover any of it
+            for(uint64_t i = 0; i < fvm_registers[GP1] && fvm_registers[MDR] + i < aot_program->length; i++)
+                if(aot_is_code(fvm_registers[MDR] + i))
+                    return AOT_STORE_MODIFIED;
+    }
+
+    return AOT_STORE_DONE;
+}
+
+_Bool aot_call(uint64_t cea) { // Push cea onto the Callstack
+    if(quota_push()) // Try to grow the callstack if it needs to include the address of this call
+        return 1;
+
+    fvm_registers[CSP] = files[CST].length - 1;
+    files[CST].self[fvm_registers[CSP]] = cea;
+
+    return 0;
+}
+
+_Bool aot_return(uint64_t *cea) { // Pop the Callstack into *cea
+    if(!(fvm_registers[CSP] + 1)) { // If there is nothing to pop from the Callstack
+        fprintf(stderr, "fvmr -> Callstack underflow");
+
+        return 1;
+    }
+
+    files[CST].length = fvm_registers[CSP];
+    *cea = files[CST].self[fvm_registers[CSP]--];
+
+    return 0;
+}
+
+void aot_interpret(uint64_t cea, uint64_t acc, uint64_t dat) { // Hand execution over to the pinned interpreter at cea
+    fvm_registers[CEA] = cea;
+    fvm_registers[ACC] = acc;
+    fvm_registers[DAT] = dat;
+
+    if(cea >= files[MEM].length) { // A computed jump can go anywhere, but the interpreter can't run from outside Main Memory
+        fprintf(stderr, "fvmr -> Execution ran past the end of Main Memory at address '%zu'\n", cea);
+
+        fvmr_exit_code = FVMR_EXIT_FAILURE_EXECUTION;
+
+        return;
+    }
+
+    fvmgl_poll_init(FVMGL_POLL_EVERY, 0); // Counted from here on in instructions, as the interpreter counts them
+
+    pinned_run(UINT64_MAX);
+}
+
+int aot_main(const struct aot_program *program) { // Load the program's ROM and devices, run it, and clean up
+    aot_program = program;
+
+    console_input = stdin;
+    console_output = stdout;
+
+    if((files[CST] = (struct fvm_file){.self = calloc(ALLOC_SIZE, sizeof(uint64_t)), .size = ALLOC_SIZE, .length = 0}).self == NULL) { // Try to initialise Callstack
+        perror("fvmr -> Could not allocate memory for Callstack");
+
+        return FVMR_EXIT_FAILURE_INITIAL_ALLOCATION;
+    }
+
+    if((files[MEM].self = calloc(program->length, sizeof(uint64_t))) == NULL) { // Main Memory starts out as a copy of the ROM, since it can be written to
+        perror("fvmr -> Could not allocate memory for Main Memory");
+
+        free(files[CST].self);
+
+        return FVMR_EXIT_FAILURE_INITIAL_ALLOCATION;
+    }
+
+    memcpy(files[MEM].self, program->rom, program->length * sizeof(uint64_t));
+
+    files[MEM].size = files[MEM].length = program->length;
+
+    if((disk = fopen(FVM_DISK, "rb+")) == NULL) { // Try to open Secondary Storage for runtime
+        perror("fvmr -> Could not access Disk");
+
+        free(files[CST].self);
+        free(files[MEM].self);
+
+        return FVMR_EXIT_FAILURE_INITIAL_FILE_ACCESS;
+    }
+
+    fvmgl_screen_object.deferred = 1; // Initialised on the first use of the screen buffer or keyboard, as by fvmr
+
+    fvmgl_poll_init(FVMGL_POLL_EVERY, 0);
+
+    program->run();
+
+    fvmgl_poll_end();
+
+    if(fvmr_exit_code != FVMR_EXIT_SUCCESS) // Produce a traceback if there were errors
+        traceback();
+
+    // Cleanup:
+
+    free(files[CST].self);
+    free(files[MEM].self);
+
+    paged_end(&paged);
+
+    fclose(disk);
+
+    fvmkbd_end();
+    fvmgl_end();
+
+    return fvmr_exit_code;
+}
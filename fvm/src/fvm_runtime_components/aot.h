@@ -0,0 +1,107 @@
+#ifndef FVMR_AOT_H
+
+#define FVMR_AOT_H
+
+// Support for ROMs translated ahead of time by fvmc:
+// (The translation is a C file with a label per instruction, which uses the macros below and is linked against the runtime components)
+
+#include <string.h>
+#include "global.h"
+#include "instructions.h"
+#include "pinned.h"
+#include "fvmgl.h"
+#include "fvmkbd.h"
+
+enum aot_store_result { // What aot_store() did
+    AOT_STORE_DONE = 0, // The store went through
+    AOT_STORE_FAILED = 1, // The store failed, having reported why
+    AOT_STORE_MODIFIED = 2 // The store went through, but wrote over translated code, so the translation no longer matches Main Memory
+};
+
+struct aot_program { // A ROM translated by fvmc
+    const char *source; // Path of the ROM it was translated from
+    const uint64_t *rom, // The ROM, which is loaded into Main Memory
+                   *code; // Bitmap of the cells in the ROM that are covered by translated instructions
+    uint64_t length; // Number of cells in the ROM
+    void (*run)(void); // The translation, which runs from address 0 until fi or an error, setting fvmr_exit_code
+};
+
+extern const struct aot_program *aot_program; // The program being run
+extern uint64_t aot_jumps; // Number of jumps the translation has taken, which AOT_TICK() polls for window events by
+
+extern int aot_main(const struct aot_program *program); // Load the program's ROM and devices, run it, and clean up, returning the exit code
+extern enum aot_store_result aot_store(void); // st through store(), saying if it wrote over translated code
+extern _Bool aot_call(uint64_t cea); // Push cea onto the Callstack, returns 1 on failure
+extern _Bool aot_return(uint64_t *cea); // Pop the Callstack into *cea (the address of the cl being returned from), returns 1 on underflow
+extern void aot_interpret(uint64_t cea, uint64_t acc, uint64_t dat); // Hand execution over to the pinned interpreter at cea for the rest of the run
+
+static inline _Bool aot_is_code(uint64_t address) { // If address is covered by a translated instruction
+    return address < aot_program->length && aot_program->code[address >> 6] >> (address & 63) & 1;
+}
+
+// Used by translations, whose run function has locals cea, acc and dat, a label address_<n> for each instruction at address n, and labels dispatch (for a jump to cea), interpret, error, end, graphics_error and keyboard_error:
+
+#define AOT_TICK() do { \
+        if(++aot_jumps >= fvmgl_polling.next) { \
+            if(fvmgl_tick(aot_jumps)) \
+                goto graphics_error; \
+            if(fvmkbd_tick()) \
+                goto keyboard_error; \
+        } \
+    } while(0) // Poll for events once enough jumps have gone by, counting them in place of the instructions that translations don't keep track of
+
+#define AOT_JUMP(target) do { AOT_TICK(); goto address_##target; } while(0)
+
+#define AOT_STORE(address) do { \
+        if(fvm_registers[MCH] == MEM && fvm_registers[MAR] < files[MEM].length && !aot_is_code(fvm_registers[MAR])) { \
+            files[MEM].self[fvm_registers[MAR]] = fvm_registers[MDR]; \
+        } else { \
+            cea = (address); \
+            switch(aot_store()) { \
+                case AOT_STORE_FAILED: \
+                    goto error; \
+                case AOT_STORE_MODIFIED: /* Carry on in the interpreter, which runs whatever is in Main Memory now */ \
+                    cea++; \
+                    goto interpret; \
+                case AOT_STORE_DONE: \
+                    break; \
+            } \
+        } \
+    } while(0)
+
+#define AOT_LOAD(address) do { \
+        if(fvm_registers[MCH] == MEM) { \
+            fvm_registers[MDR] = fvm_registers[MAR] < files[MEM].length ? files[MEM].self[fvm_registers[MAR]] : paged_load(&paged, fvm_registers[MAR]); \
+        } else if(load()) { \
+            cea = (address); \
+            goto error; \
+        } \
+    } while(0)
+
+#define AOT_CALL(address, target) do { \
+        if(aot_call(address)) { \
+            cea = (address); \
+            goto error; \
+        } \
+        AOT_JUMP(target); \
+    } while(0)
+
+#define AOT_RETURN(address) do { \
+        cea = (address); \
+        if(aot_return(&cea)) \
+            goto error; \
+        cea += 2; /* Past the cl's operand */ \
+        goto dispatch; \
+    } while(0)
+
+#define AOT_MOVE_TO_CEA(value) do { \
+        cea = (value) + 3; /* Moved past by mv and the execution cycle */ \
+        goto dispatch; \
+    } while(0)
+
+#define AOT_FINISH(address) do { \
+        cea = (address); \
+        goto end; \
+    } while(0)
+
+#endif
@@ -0,0 +1,386 @@
+/* Fox Virtual Machine: Basic Block Engine
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// This engine runs the decoded stream (see decoder.c) a block at a time. A block is copied out of the decoded stream the
+// first time execution reaches its start address, and runs until a jump, call or return, from a dense array of its own.
+// Each block is linked to the blocks that execution goes on to as they're found, so that a loop, once it has run through,
+// goes from block to block without going back to the cache. Whether anything from service_run() is due is checked once
+// per block, rather than once per instruction.
+//
+// Stores into Main Memory check a bitmap of which pages have code on them, and only look for blocks to invalidate on those
+// pages. An invalidated block stays where it is, so that links to it never dangle, and is rebuilt in place the next time
+// execution reaches it.
+
+#include "block.h"
+#include "handlers.h"
+#include "jit.h"
+#include "cache.h"
+#include "service.h"
+
+#define HANDLER(op) BLOCK_HANDLER(op)
+#define HANDLER_SLOT (*ip)
+#define HANDLER_NEXT() do { executed++; cea++; ip++; BLOCK_DISPATCH(); } while(0)
+#define HANDLER_EXIT(taken) do { executed++; cea++; BLOCK_FOLLOW(taken); } while(0) // BLOCK_LINK_NOT_TAKEN and BLOCK_LINK_TAKEN are 0 and 1
+#define HANDLER_EXIT_DYNAMIC() do { executed++; cea++; BLOCK_FOLLOW(BLOCK_LINK_DYNAMIC); } while(0)
+#define HANDLER_WRITTEN(address) do { decoder_invalidate(address); block_invalidate(address); BLOCK_CHECK_VALID(); } while(0)
+#define HANDLER_RELOAD() do { mem = files[MEM].self; BLOCK_CHECK_VALID(); } while(0)
+
+#ifdef FVMR_COMPUTED_GOTO
+#define BLOCK_HANDLER(op) handler_##op
+#define BLOCK_DISPATCH() goto *handlers[ip->op]
+#else
+#define BLOCK_HANDLER(op) case op
+#define BLOCK_DISPATCH() goto dispatch
+#endif
+
+#define BLOCK_ENTER() do { /* Do anything from service_run() that is due, and start running the block, natively if it's been translated */ \
+        if(SERVICE_DUE(executed)) { \
+            fvm_registers[ACC] = acc; \
+            fvm_registers[DAT] = dat; \
+            \
+            if(service_run(cea, executed)) \
+                goto end; \
+        } \
+        \
+        if(block->native != NULL || (jit.code != NULL && ++block->heat == JIT_THRESHOLD && !jit_compile(block))) \
+            goto native; \
+        \
+        ip = block->code; \
+        \
+        BLOCK_DISPATCH(); \
+    } while(0)
+
+#define BLOCK_FOLLOW(link) do { /* Go on to the block at cea, through a link if there is one, otherwise through the cache */ \
+        next = block->links[link]; \
+        \
+        if(next != NULL && next->valid && ((link) != BLOCK_LINK_DYNAMIC || next->start == cea)) { /* Only returns and moves into CEA can go somewhere different each time */ \
+            block = next; \
+            \
+            BLOCK_ENTER(); \
+        } \
+        \
+        successor = &block->links[link]; \
+        \
+        goto lookup; \
+    } while(0)
+
+#define BLOCK_CHECK_VALID() do { /* If a store has invalidated the running block, leave it after the current instruction */ \
+        if(!block->valid) \
+            ip = block_leave; \
+    } while(0)
+
+struct fvmr_blocks blocks = {
+    .table = NULL,
+    .pages = NULL,
+    .length = 0,
+    .built = 0,
+    .invalidated = 0,
+    .lookups = 0
+};
+
+static struct decoded_instruction block_leave[2] = { // Stands in for the rest of a block that was invalidated while running
+    [1] = {.op = BLOCK_CONTINUE}
+};
+
+static uint64_t block_pages_size(uint64_t length) { // Number of words in the code bitmap for length cells
+    return ((length >> BLOCK_PAGE_SHIFT) >> 6) + 1;
+}
+
+static _Bool block_is_terminator(const struct decoded_instruction *slot) { // If the instruction in slot ends a block
+    switch(slot->op) {
+        case DECODED_PLACE_CEA:
+        case DECODED_JUMP:
+        case DECODED_JUMP_IF_SET:
+        case DECODED_JUMP_IF_CLEAR:
+        case DECODED_CALL:
+        case DECODED_RETURN:
+        case DECODED_FINISH:
+        case DECODED_GT_JUMP_IF_SET:
+        case DECODED_GT_JUMP_IF_CLEAR:
+        case DECODED_LT_JUMP_IF_SET:
+        case DECODED_LT_JUMP_IF_CLEAR:
+        case DECODED_GE_JUMP_IF_SET:
+        case DECODED_GE_JUMP_IF_CLEAR:
+        case DECODED_LE_JUMP_IF_SET:
+        case DECODED_LE_JUMP_IF_CLEAR:
+        case DECODED_EQ_JUMP_IF_SET:
+        case DECODED_EQ_JUMP_IF_CLEAR:
+        case DECODED_NE_JUMP_IF_SET:
+        case DECODED_NE_JUMP_IF_CLEAR:
+            return 1;
+        case DECODED_MOVE_ANY:
+            return slot->reg[1] == CEA;
+        default:
+            return 0;
+    }
+}
+
+static _Bool block_build(struct fvmr_block *block, uint64_t address) { // Copy the block starting at address out of the decoded stream
+    struct decoded_instruction *slot;
+    uint64_t length = 0,
+             page;
+
+    if(decoder.code[address].op == DECODED_UNDECODED && decoder_decode(address, DECODER_RUNNING)) // Only the first instruction is decoded here, since it's about to run
+        return 1;
+
+    block->start = address;
+    block->native = NULL;
+    block->heat = cache_is_hot(address) ? JIT_THRESHOLD - 1 : 0; // Blocks that got hot last time are translated as soon as they're entered
+
+    memset(block->links, 0, sizeof(block->links));
+
+    for(;;) {
+        slot = &decoder.code[address];
+
+        block->code[length++] = *slot;
+
+        address += slot->length;
+
+        if(block_is_terminator(slot))
+            break;
+
+        if(decoder.code[address].op == DECODED_UNDECODED || address + decoder.code[address].length - block->start > BLOCK_MAX_CELLS) { // Anything not decoded yet is left to its own block, so that it's decoded when it's reached
+            block->code[length] = (struct decoded_instruction){.op = BLOCK_CONTINUE};
+
+            break;
+        }
+    }
+
+    block->cells = address - block->start;
+    block->valid = 1;
+
+    for(page = block->start >> BLOCK_PAGE_SHIFT; page <= (address - 1) >> BLOCK_PAGE_SHIFT; page++) // Mark the block's pages as having code on them
+        blocks.pages[page >> 6] |= (uint64_t)1 << (page & 63);
+
+    blocks.built++;
+
+    return 0;
+}
+
+_Bool block_init(void) { // Allocate the block cache
+    blocks.length = decoder.length;
+
+    if((blocks.table = calloc(blocks.length, sizeof(struct fvmr_block *))) == NULL || (blocks.pages = calloc(block_pages_size(blocks.length), sizeof(uint64_t))) == NULL) {
+        perror("fvmr -> Could not allocate memory for block cache");
+
+        return 1;
+    }
+
+    return 0;
+}
+
+struct fvmr_block *block_get(uint64_t address) { // Return the valid block starting at address
+    struct fvmr_block *block;
+
+    blocks.lookups++;
+
+    if(address >= blocks.length) { // Past the end of Main Memory, which the decoder reports
+        decoder_decode(address, DECODER_RUNNING);
+
+        return NULL;
+    }
+
+    if((block = blocks.table[address]) != NULL && block->valid)
+        return block;
+
+    if(block == NULL) { // Nothing has started here before
+        if((block = calloc(1, sizeof(struct fvmr_block))) == NULL) {
+            perror("fvmr -> Could not allocate memory for block");
+
+            return NULL;
+        }
+
+        blocks.table[address] = block;
+    }
+
+    if(block_build(block, address))
+        return NULL;
+
+    return block;
+}
+
+void block_invalidate_page(uint64_t address) { // Invalidate every block covering address
+    struct fvmr_block *block;
+    uint64_t page = address >> BLOCK_PAGE_SHIFT,
+             first = page << BLOCK_PAGE_SHIFT,
+             i;
+    _Bool invalidated = 0;
+
+    for(i = address >= BLOCK_MAX_CELLS - 1 ? address - (BLOCK_MAX_CELLS - 1) : 0; i <= address; i++) {
+        if((block = blocks.table[i]) != NULL && block->valid && i + block->cells > address) {
+            block->valid = 0;
+
+            blocks.invalidated++;
+
+            invalidated = 1;
+        }
+    }
+
+    if(!invalidated)
+        return;
+
+    for(i = first >= BLOCK_MAX_CELLS - 1 ? first - (BLOCK_MAX_CELLS - 1) : 0; i < first + ((uint64_t)1 << BLOCK_PAGE_SHIFT) && i < blocks.length; i++) // Keep the page marked if it still has valid code on it
+        if((block = blocks.table[i]) != NULL && block->valid && i + block->cells > first)
+            return;
+
+    blocks.pages[page >> 6] &= ~((uint64_t)1 << (page & 63));
+}
+
+_Bool block_resize(void) { // Grow the block cache to match Main Memory
+    uint64_t length = files[MEM].length + 1,
+             pages_size = block_pages_size(blocks.length),
+             new_pages_size;
+
+    if(length <= blocks.length)
+        return 0;
+
+    if(length < blocks.length * 2) // Geometrically, as the decoded stream does
+        length = blocks.length * 2;
+
+    new_pages_size = block_pages_size(length);
+
+    if((alloc_buff = (void *)realloc(blocks.table, length * sizeof(struct fvmr_block *))) == NULL) {
+        perror("fvmr -> Could not allocate memory for block cache");
+
+        return 1;
+    }
+
+    blocks.table = (struct fvmr_block **)alloc_buff;
+
+    memset(&blocks.table[blocks.length], 0, (length - blocks.length) * sizeof(struct fvmr_block *)); // Nothing starts in the new cells yet
+
+    if((alloc_buff = (void *)realloc(blocks.pages, new_pages_size * sizeof(uint64_t))) == NULL) {
+        perror("fvmr -> Could not allocate memory for block cache");
+
+        return 1;
+    }
+
+    blocks.pages = (uint64_t *)alloc_buff;
+
+    memset(&blocks.pages[pages_size], 0, (new_pages_size - pages_size) * sizeof(uint64_t));
+
+    blocks.length = length;
+
+    return 0;
+}
+
+void block_run(void) { // Execute with the block engine
+    uint64_t *mem = files[MEM].self, // Main Memory, reloaded after anything that could have reallocated it
+             cea = fvm_registers[CEA], // 0 at boot, or wherever a fork server's snapshot was taken
+             acc = fvm_registers[ACC],
+             dat = fvm_registers[DAT],
+             value,
+             executed = 0;
+    struct fvmr_block *block, // The block being run
+                      *next, // The block being gone on to
+                      *unlinked = NULL, // Where the link to the first block is put, since nothing comes before it
+                      **successor = &unlinked; // The link to fill in with the block found by the next lookup
+    struct decoded_instruction *ip; // The instruction being run, in block->code
+    struct jit_exit exit; // How the last translation to run left its block
+
+#ifdef FVMR_COMPUTED_GOTO
+    static const void *handlers[NO_DECODED_OPS + 1] = {
+        [DECODED_UNDECODED] = &&handler_DECODED_UNDECODED,
+        HANDLER_LABELS
+        [BLOCK_CONTINUE] = &&handler_BLOCK_CONTINUE
+    };
+#endif
+
+    goto lookup;
+
+#ifndef FVMR_COMPUTED_GOTO
+dispatch:
+    switch(ip->op) {
+#endif
+    BLOCK_HANDLER(DECODED_UNDECODED): // Blocks never hold undecoded slots, since they stop before them
+    BLOCK_HANDLER(BLOCK_CONTINUE): // The end of a block that was cut short, or invalidated while running, with cea already on the next instruction
+        if(!block->valid) { // Left part of the way through, so its links don't lead on from here
+            successor = &unlinked;
+
+            goto lookup;
+        }
+
+        BLOCK_FOLLOW(BLOCK_LINK_NOT_TAKEN);
+#include "handler_bodies.h"
+#ifndef FVMR_COMPUTED_GOTO
+    }
+#endif
+
+lookup: // Find the block at cea through the cache, and link the block that came before to it
+    if((block = block_get(cea)) == NULL)
+        goto execution_error;
+
+    *successor = block;
+
+    BLOCK_ENTER();
+native: // Run the block's translation, which works on the registers in fvm_registers, then carry on from wherever it left
+    fvm_registers[ACC] = acc;
+    fvm_registers[DAT] = dat;
+
+    jit.current = block;
+
+    exit = block->native();
+
+    mem = files[MEM].self; // Helpers called from the translation can reallocate it
+    cea = fvm_registers[CEA];
+    acc = fvm_registers[ACC];
+    dat = fvm_registers[DAT];
+
+    executed += exit.executed;
+
+    switch(exit.kind) {
+        case JIT_EXIT_NOT_TAKEN:
+            BLOCK_FOLLOW(BLOCK_LINK_NOT_TAKEN);
+        case JIT_EXIT_TAKEN:
+            BLOCK_FOLLOW(BLOCK_LINK_TAKEN);
+        case JIT_EXIT_INTERPRET: // The rest of the block is interpreted, from the instruction at cea
+            ip = &block->code[exit.resume];
+
+            BLOCK_DISPATCH();
+        case JIT_EXIT_LEAVE:
+            successor = &unlinked;
+
+            goto lookup;
+        default:
+            goto execution_error;
+    }
+execution_error:
+    fvmr_exit_code = FVMR_EXIT_FAILURE_EXECUTION;
+end: // Write the registers held in locals back for the traceback and anything run afterwards
+    fvm_registers[CEA] = cea;
+    fvm_registers[ACC] = acc;
+    fvm_registers[DAT] = dat;
+
+    fvmr_stats.instructions += executed;
+}
+
+void block_report(void) { // Print how many blocks were built, invalidated and looked up
+    if(blocks.table == NULL)
+        return;
+
+    fprintf(stderr,
+            "\tBlocks built: %zu\n"
+            "\tBlocks invalidated: %zu\n"
+            "\tBlock cache lookups: %zu\n",
+            blocks.built,
+            blocks.invalidated,
+            blocks.lookups);
+}
+
+void block_end(void) { // Cleanup
+    if(blocks.table != NULL)
+        for(uint64_t i = 0; i < blocks.length; i++)
+            free(blocks.table[i]);
+
+    free(blocks.table);
+    free(blocks.pages);
+
+    blocks.table = NULL;
+    blocks.pages = NULL;
+    blocks.length = 0;
+}
@@ -0,0 +1,55 @@
+#ifndef FVMR_BLOCK_H
+
+#define FVMR_BLOCK_H
+
+#include "global.h"
+#include "decoder.h"
+
+#define BLOCK_MAX_CELLS 64 // Most cells of Main Memory that one block can cover, so that invalidation only has to look this far back
+#define BLOCK_PAGE_SHIFT 6 // Pages of the code bitmap are 1 << BLOCK_PAGE_SHIFT cells
+#define BLOCK_CONTINUE NO_DECODED_OPS // Not an instruction: ends a block that was cut short, carrying on at the address after it
+
+enum block_link { // Successors that a block can be chained to
+    BLOCK_LINK_NOT_TAKEN = 0, // Where execution falls through to
+    BLOCK_LINK_TAKEN = 1, // Where the jump or call at the end of the block goes
+    BLOCK_LINK_DYNAMIC = 2, // Where rt or a mv into CEA went last time
+    NO_BLOCK_LINKS
+};
+
+struct jit_exit;
+
+struct fvmr_block { // A run of instructions ending at a jump, call or return, decoded once and cached by its start address
+    struct decoded_instruction code[BLOCK_MAX_CELLS + 1]; // The instructions, ending with a terminator or BLOCK_CONTINUE
+    struct fvmr_block *links[NO_BLOCK_LINKS]; // Blocks that execution has gone on to, followed without going through the cache
+    struct jit_exit (*native)(void); // Translation of the block into native code (see jit.c), NULL until it's hot
+    uint64_t start, // Address of the first instruction
+             cells, // Number of cells of Main Memory covered
+             heat; // Number of times the block has been entered since it was built, for the jit engine
+    _Bool valid; // Cleared when a store hits the block, which is then rebuilt in place the next time it's looked up
+};
+
+extern struct fvmr_blocks { // The block cache
+    struct fvmr_block **table; // Blocks, indexed by start address (NULL if the engine in use doesn't use blocks)
+    uint64_t *pages, // Code bitmap: a set bit means that a block might cover some cell of that page
+             length, // Number of entries in table (the same as decoder.length)
+             built, // Number of times a block has been built or rebuilt
+             invalidated, // Number of times a block has been invalidated by a store
+             lookups; // Number of block transitions that went through the cache rather than a link
+} blocks;
+
+extern _Bool block_init(void); // Allocate the block cache, after decoder_init()
+extern struct fvmr_block *block_get(uint64_t address); // Return the valid block starting at address, building it if it needs to be. Returns NULL (having reported why) if the instruction there isn't valid
+extern void block_invalidate_page(uint64_t address); // Invalidate every block covering address, on a page with code on it
+extern _Bool block_resize(void); // Grow the block cache to match Main Memory after it has grown
+extern void block_run(void); // Execute from CEA with the block engine until fi or an error, setting fvmr_exit_code
+extern void block_report(void); // Print how many blocks were built, invalidated and looked up
+extern void block_end(void); // Cleanup
+
+static inline void block_invalidate(uint64_t address) { // Forget every block that covers address, if its page has any code on it
+    uint64_t page = address >> BLOCK_PAGE_SHIFT;
+
+    if(address < blocks.length && blocks.pages[page >> 6] & (uint64_t)1 << (page & 63))
+        block_invalidate_page(address);
+}
+
+#endif
@@ -0,0 +1,76 @@
+/* Fox Virtual Machine: Execution Budget
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// Neither limit adds anything to the engines' loops: the instruction limit is folded into service.due, which they
+// already compare against, and the wall-clock limit is a timer whose signal brings service.due forward to 0.
+
+#include "budget.h"
+#include "service.h"
+
+#include <signal.h>
+#include <sys/time.h>
+
+struct fvmr_budget budget = {
+    .instructions = UINT64_MAX,
+    .seconds = 0,
+    .expired = 0
+};
+
+static void budget_alarm(int signal) { // SIGALRM handler, for when the wall-clock limit passes
+    (void)signal;
+
+    atomic_store(&budget.expired, 1);
+
+    service_interrupt();
+}
+
+void budget_init(uint64_t instructions, double seconds) { // Start the budget for a run
+    struct sigaction action = {.sa_handler = budget_alarm, .sa_flags = SA_RESTART};
+    struct itimerval timer = {0};
+
+    budget.instructions = instructions;
+    budget.seconds = seconds;
+
+    atomic_store(&budget.expired, 0);
+
+    if(seconds > 0) {
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGALRM, &action, NULL);
+
+        timer.it_value.tv_sec = (time_t)seconds;
+        timer.it_value.tv_usec = (suseconds_t)((seconds - (time_t)seconds) * 1e6);
+
+        if(!timer.it_value.tv_sec && !timer.it_value.tv_usec) // Too short to set, so it's already over
+            budget_alarm(SIGALRM);
+        else
+            setitimer(ITIMER_REAL, &timer, NULL);
+    }
+
+    service_schedule();
+}
+
+_Bool budget_exhausted(uint64_t executed) { // If the run has gone over budget
+    if(executed >= budget.instructions) {
+        fprintf(stderr, "fvmr -> Instruction budget of %zu exhausted\n", budget.instructions);
+    } else if(atomic_load(&budget.expired)) {
+        fprintf(stderr, "fvmr -> Time budget of %gs exhausted\n", budget.seconds);
+    } else {
+        return 0;
+    }
+
+    fvmr_exit_code = FVMR_EXIT_FAILURE_BUDGET;
+
+    return 1;
+}
+
+void budget_end(void) { // Stop the wall-clock limit
+    struct itimerval timer = {0};
+
+    if(budget.seconds > 0)
+        setitimer(ITIMER_REAL, &timer, NULL);
+}
@@ -0,0 +1,18 @@
+#ifndef FVMR_BUDGET_H
+
+#define FVMR_BUDGET_H
+
+#include <stdatomic.h>
+#include "global.h"
+
+extern struct fvmr_budget { // Limits on how long the ROM may run for, past which it's stopped with FVMR_EXIT_FAILURE_BUDGET
+    uint64_t instructions; // Instructions it may run (UINT64_MAX for no limit), checked once per block or jump, so it can run a few past it
+    double seconds; // Wall-clock seconds it may run for (0 for no limit)
+    _Atomic _Bool expired; // If the wall-clock limit has passed
+} budget;
+
+extern void budget_init(uint64_t instructions, double seconds); // Start the budget for a run, with UINT64_MAX and 0 for no limit on instructions and time
+extern _Bool budget_exhausted(uint64_t executed); // If the run has gone over budget, having reported it and set fvmr_exit_code
+extern void budget_end(void); // Stop the wall-clock limit
+
+#endif
@@ -0,0 +1,188 @@
+/* Fox Virtual Machine: Bulk Memory Operations
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// Each operation works directly on the array in files[MEM] for as much of its range as lies within it, with memmove() or
+// loops that the compiler vectorises, and cell by cell through memory_load() and memory_store() for anything past it.
+// A copy or fill that ends past the end of Main Memory first grows it over its last cell, as a loop writing that far
+// would have, so that it's only left cell by cell when the range reaches into paged memory.
+
+#include "bulk.h"
+#include "instructions.h"
+
+#include <string.h>
+
+static _Bool bulk_range(uint64_t address, uint64_t cells) { // Check that an operation can cover cells from address, returns 1 (having reported it) if it can't
+    if(cells <= BULK_MAX_CELLS && address <= UINT64_MAX - cells)
+        return 0;
+
+    fprintf(stderr, "fvmr -> Attempted a bulk operation on %zu cells from address %zu, which is out of range\n", cells, address);
+
+    return 1;
+}
+
+static _Bool bulk_reach(uint64_t to, uint64_t cells) { // Grow Main Memory over the last of cells from to, if they end past it, returns 1 (having reported why) on failure
+    if(to + cells <= files[MEM].length)
+        return 0;
+
+    return memory_store(to + cells - 1, memory_load(to + cells - 1)); // (Leaving it as it was)
+}
+
+_Bool bulk_copy(uint64_t to, uint64_t from, uint64_t cells) { // Copy cells from from to to, which may overlap
+    if(!cells || to == from)
+        return 0;
+
+    if(bulk_reach(to, cells))
+        return 1;
+
+    if(to + cells <= files[MEM].length && from + cells <= files[MEM].length) { // Both within the array
+        memmove(&files[MEM].self[to], &files[MEM].self[from], cells * sizeof(uint64_t));
+
+        memory_invalidate(to, to + cells);
+
+        return 0;
+    }
+
+    if(to > from && to - from < cells) { // Overlapping from above, so copied from the end down
+        for(uint64_t i = cells; i--;)
+            if(memory_store(to + i, memory_load(from + i)))
+                return 1;
+
+        return 0;
+    }
+
+    for(uint64_t i = 0; i < cells; i++)
+        if(memory_store(to + i, memory_load(from + i)))
+            return 1;
+
+    return 0;
+}
+
+_Bool bulk_fill(uint64_t to, uint64_t value, uint64_t cells) { // Set cells from to to value
+    uint64_t *cell;
+
+    if(!cells)
+        return 0;
+
+    if(bulk_reach(to, cells))
+        return 1;
+
+    if(to + cells <= files[MEM].length) { // Within the array
+        cell = &files[MEM].self[to];
+
+        for(uint64_t i = 0; i < cells; i++)
+            cell[i] = value;
+
+        memory_invalidate(to, to + cells);
+
+        return 0;
+    }
+
+    for(uint64_t i = 0; i < cells; i++)
+        if(memory_store(to + i, value))
+            return 1;
+
+    return 0;
+}
+
+uint64_t bulk_compare(uint64_t a, uint64_t b, uint64_t cells) { // Cells from a equal to those from b before the first that isn't
+    const uint64_t *x = &files[MEM].self[a],
+                   *y = &files[MEM].self[b];
+    uint64_t higher = a > b ? a : b,
+             within = higher < files[MEM].length ? files[MEM].length - higher : 0, // Cells of both that are in the array
+             differ,
+             i = 0;
+
+    if(within > cells)
+        within = cells;
+
+    for(; i + BULK_LANES <= within; i += BULK_LANES) { // A lane of cells at a time up to the one with the difference
+        differ = 0;
+
+        for(uint64_t j = 0; j < BULK_LANES; j++)
+            differ |= x[i + j] ^ y[i + j];
+
+        if(differ)
+            break;
+    }
+
+    for(; i < within; i++) // Then the cell itself
+        if(x[i] != y[i])
+            return i;
+
+    for(; i < cells; i++) // Anything past the array
+        if(memory_load(a + i) != memory_load(b + i))
+            return i;
+
+    return cells;
+}
+
+uint64_t bulk_search(uint64_t from, uint64_t value, uint64_t cells) { // Cells from from before the first equal to value
+    const uint64_t *x = &files[MEM].self[from];
+    uint64_t within = from < files[MEM].length ? files[MEM].length - from : 0, // Cells that are in the array
+             i = 0;
+    _Bool found;
+
+    if(within > cells)
+        within = cells;
+
+    for(; i + BULK_LANES <= within; i += BULK_LANES) { // A lane of cells at a time up to the one with the value
+        found = 0;
+
+        for(uint64_t j = 0; j < BULK_LANES; j++)
+            found |= x[i + j] == value;
+
+        if(found)
+            break;
+    }
+
+    for(; i < within; i++) // Then the cell itself
+        if(x[i] == value)
+            return i;
+
+    for(; i < cells; i++) // Anything past the array
+        if(memory_load(from + i) == value)
+            return i;
+
+    return cells;
+}
+
+_Bool bulk_store(void) { // st on BLK
+    switch(fvm_registers[MAR]) {
+        case BULK_COPY:
+            return bulk_range(fvm_registers[MDR], fvm_registers[GP1]) || bulk_range(fvm_registers[GP0], fvm_registers[GP1]) || bulk_copy(fvm_registers[MDR], fvm_registers[GP0], fvm_registers[GP1]);
+        case BULK_FILL:
+            return bulk_range(fvm_registers[MDR], fvm_registers[GP1]) || bulk_fill(fvm_registers[MDR], fvm_registers[GP0], fvm_registers[GP1]);
+        default:
+            fprintf(stderr, "fvmr -> Attempted to store to MAR %zu on MCH BLK (bulk operations). This operation is invalid.\n", fvm_registers[MAR]);
+
+            return 1;
+    }
+}
+
+_Bool bulk_load(void) { // ld on BLK
+    switch(fvm_registers[MAR]) {
+        case BULK_COMPARE:
+            if(bulk_range(fvm_registers[MDR], fvm_registers[GP1]) || bulk_range(fvm_registers[GP0], fvm_registers[GP1]))
+                return 1;
+
+            fvm_registers[MDR] = bulk_compare(fvm_registers[MDR], fvm_registers[GP0], fvm_registers[GP1]);
+
+            return 0;
+        case BULK_SEARCH:
+            if(bulk_range(fvm_registers[MDR], fvm_registers[GP1]))
+                return 1;
+
+            fvm_registers[MDR] = bulk_search(fvm_registers[MDR], fvm_registers[GP0], fvm_registers[GP1]);
+
+            return 0;
+        default:
+            fprintf(stderr, "fvmr -> Attempted to load from MAR %zu on MCH BLK (bulk operations). This operation is invalid.\n", fvm_registers[MAR]);
+
+            return 1;
+    }
+}
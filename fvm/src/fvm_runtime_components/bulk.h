@@ -0,0 +1,36 @@
+#ifndef FVMR_BULK_H
+
+#define FVMR_BULK_H
+
+// The bulk channel (MCH BLK) runs a whole loop over a range of Main Memory as one st or ld. MAR says which operation, MDR
+// is the address of the range and GP1 the number of cells in it, with GP0 as the other operand (GPs rather than ACC and
+// DAT, since every engine writes them back to fvm_registers for a st or ld):
+//   st, MAR 0 (copy):    copy GP1 cells from GP0 to MDR, as memmove() does when they overlap
+//   st, MAR 1 (fill):    set GP1 cells from MDR to GP0
+//   ld, MAR 2 (compare): MDR = how many cells from MDR are equal to those from GP0 before the first that isn't (GP1 if
+//                        they all are)
+//   ld, MAR 3 (search):  MDR = how many cells from MDR come before the first that's equal to GP0 (GP1 if none is)
+// Ranges can go past the end of Main Memory, as single st and ld can, but not past BULK_MAX_CELLS or the end of the
+// address space. A failed operation is reported like a failed st or ld, having done as much of it as a loop would have.
+
+#include "global.h"
+
+#define BULK_MAX_CELLS ((uint64_t)1 << 32) // Most cells that an operation can cover
+#define BULK_LANES 8 // Cells that compare and search look at together, which the compiler vectorises
+
+enum fvmr_bulk_operation { // What MAR selects on BLK
+    BULK_COPY = 0, // st
+    BULK_FILL = 1, // st
+    BULK_COMPARE = 2, // ld
+    BULK_SEARCH = 3 // ld
+};
+
+// (These assume that their ranges have been checked, as bulk_store() and bulk_load() do for the guest's)
+extern _Bool bulk_copy(uint64_t to, uint64_t from, uint64_t cells); // Copy cells from from to to, which may overlap, growing or paging Main Memory as st does, returns 1 (having reported why) on failure
+extern _Bool bulk_fill(uint64_t to, uint64_t value, uint64_t cells); // Set cells from to to value, growing or paging Main Memory as st does, returns 1 (having reported why) on failure
+extern uint64_t bulk_compare(uint64_t a, uint64_t b, uint64_t cells); // Cells from a equal to those from b before the first that isn't (cells if they all are)
+extern uint64_t bulk_search(uint64_t from, uint64_t value, uint64_t cells); // Cells from from before the first equal to value (cells if none is)
+extern _Bool bulk_store(void); // st on BLK, returns 1 (having reported why) on failure
+extern _Bool bulk_load(void); // ld on BLK, returns 1 (having reported why) on failure
+
+#endif
@@ -0,0 +1,235 @@
+/* Fox Virtual Machine: Persistent Translation Cache
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// Translations themselves aren't kept, since they have the addresses of this run's globals and helpers baked into them.
+// Instead, the blocks that got translated are remembered, and are translated the first time they're entered next run.
+
+#include "cache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CACHE_BUILD FVMR_VERSION " " __DATE__ " " __TIME__ // Anything built at a different time may decode differently, so doesn't share a cache
+
+struct fvmr_cache cache = {
+    .path = NULL,
+    .hot = NULL,
+    .stream = NULL,
+    .map = NULL
+};
+
+static uint64_t cache_hash(uint64_t hash, const void *data, size_t size) { // Carry on a 64-bit FNV-1a hash over size bytes of data
+    for(size_t i = 0; i < size; i++)
+        hash = (hash ^ ((const uint8_t *)data)[i]) * UINT64_C(0x100000001b3);
+
+    return hash;
+}
+
+static uint64_t cache_stream_size(void) { // Bytes of decoded stream in the cache file
+    return (cache.length + 1) * sizeof(struct decoded_instruction);
+}
+
+_Bool cache_load(const char *directory) { // Fill the decoded stream from the cache for the ROM in Main Memory
+    struct cache_header header;
+    struct stat status;
+    int fd;
+
+    if(directory == NULL)
+        return 1;
+
+    cache.key = cache_hash(UINT64_C(0xcbf29ce484222325), files[MEM].self, files[MEM].length * sizeof(uint64_t));
+    cache.key = cache_hash(cache.key, CACHE_BUILD, sizeof(CACHE_BUILD));
+    cache.key = cache_hash(cache.key, &decoder.fuse, sizeof(decoder.fuse));
+
+    cache.length = files[MEM].length;
+    cache.hot_size = (cache.length >> 6) + 1;
+
+    if((cache.path = malloc(strlen(directory) + 24)) == NULL || (cache.hot = calloc(cache.hot_size, sizeof(uint64_t))) == NULL) {
+        perror("fvmr -> Could not allocate memory for cache");
+
+        cache_end();
+
+        return 1;
+    }
+
+    sprintf(cache.path, "%s/%016zx", directory, cache.key);
+
+    cache.dirty = 1; // Unless it turns out to be there already
+
+    if((fd = open(cache.path, O_RDONLY)) == -1) { // Not cached yet
+        if(errno != ENOENT)
+            perror("fvmr -> Could not access cache");
+        else
+            mkdir(directory, 0777); // So that it can be written on exit, which reports it if the directory still isn't there
+
+        return 1;
+    }
+
+    if(fstat(fd, &status) || (size_t)status.st_size < sizeof(header) || (cache.map = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+        cache.map = NULL;
+
+        close(fd);
+
+        return 1;
+    }
+
+    close(fd);
+
+    cache.map_size = status.st_size;
+
+    memcpy(&header, cache.map, sizeof(header));
+
+    if(header.magic != CACHE_MAGIC || header.key != cache.key || header.rom_length != cache.length || header.decoded_length != cache.length + 1 ||
+       cache.map_size != sizeof(header) + cache_stream_size() + cache.hot_size * sizeof(uint64_t)) { // Left behind by something else, so it's written over on exit
+        fprintf(stderr, "fvmr -> Ignoring cache file '%s', which doesn't match the ROM\n", cache.path);
+
+        munmap(cache.map, cache.map_size);
+
+        cache.map = NULL;
+
+        return 1;
+    }
+
+    if((decoder.code = malloc(cache_stream_size())) == NULL) {
+        perror("fvmr -> Could not allocate memory for decoded instructions");
+
+        return 1;
+    }
+
+    cache.stream = (const struct decoded_instruction *)((uint8_t *)cache.map + sizeof(header));
+
+    memcpy(decoder.code, cache.stream, cache_stream_size());
+    memcpy(cache.hot, (uint8_t *)cache.map + sizeof(header) + cache_stream_size(), cache.hot_size * sizeof(uint64_t));
+
+    decoder.length = cache.length + 1;
+    decoder.extent = cache.extent = header.extent;
+
+    cache.hit = 1;
+    cache.dirty = 0;
+
+    return 0;
+}
+
+void cache_keep(void) { // Remember the decoded stream straight after decoder_init()
+    struct decoded_instruction *stream;
+
+    if(cache.path == NULL)
+        return;
+
+    if((stream = malloc(cache_stream_size())) == NULL) {
+        perror("fvmr -> Could not allocate memory for cache, so it won't be written");
+
+        cache_end();
+
+        return;
+    }
+
+    memcpy(stream, decoder.code, cache_stream_size());
+
+    cache.stream = stream;
+    cache.extent = decoder.extent;
+}
+
+void cache_save(void) { // Write the decoded stream and every block that got hot in this run to the cache
+    struct cache_header header = {
+        .magic = CACHE_MAGIC,
+        .key = cache.key,
+        .rom_length = cache.length,
+        .decoded_length = cache.length + 1,
+        .extent = cache.extent
+    };
+    struct fvmr_block *block;
+    char *temporary;
+    FILE *f;
+
+    if(cache.path == NULL || cache.stream == NULL)
+        return;
+
+    for(uint64_t i = 0; blocks.table != NULL && i < blocks.length && i >> 6 < cache.hot_size; i++) { // Add the blocks translated in this run
+        if((block = blocks.table[i]) == NULL || (block->native == NULL && block->heat < JIT_THRESHOLD) || cache_is_hot(i))
+            continue;
+
+        cache.hot[i >> 6] |= (uint64_t)1 << (i & 63);
+        cache.dirty = 1;
+    }
+
+    if(!cache.dirty)
+        return;
+
+    if((temporary = malloc(strlen(cache.path) + 24)) == NULL) {
+        perror("fvmr -> Could not allocate memory for cache");
+
+        return;
+    }
+
+    sprintf(temporary, "%s.%d", cache.path, (int)getpid()); // Written beside the cache and renamed over it, so that other runs never see half of it
+
+    if((f = fopen(temporary, "wb")) == NULL) {
+        perror("fvmr -> Could not write cache");
+
+        free(temporary);
+
+        return;
+    }
+
+    if(fwrite(&header, sizeof(header), 1, f) != 1 ||
+       fwrite(cache.stream, cache_stream_size(), 1, f) != 1 ||
+       fwrite(cache.hot, sizeof(uint64_t), cache.hot_size, f) != cache.hot_size) {
+        perror("fvmr -> Could not write cache");
+
+        fclose(f);
+        remove(temporary);
+        free(temporary);
+
+        return;
+    }
+
+    fclose(f);
+
+    if(rename(temporary, cache.path)) {
+        perror("fvmr -> Could not write cache");
+
+        remove(temporary);
+    }
+
+    free(temporary);
+}
+
+void cache_report(void) { // Print whether the cache was hit and how many blocks started out hot
+    uint64_t hot = 0;
+
+    if(cache.path == NULL)
+        return;
+
+    for(uint64_t i = 0; i < cache.hot_size; i++)
+        hot += __builtin_popcountll(cache.hot[i]);
+
+    fprintf(stderr,
+            "\tTranslation cache: %s\n"
+            "\tHot blocks known: %zu\n",
+            cache.hit ? "hit" : "miss",
+            hot);
+}
+
+void cache_end(void) { // Cleanup
+    if(cache.map != NULL)
+        munmap(cache.map, cache.map_size);
+    else
+        free((void *)cache.stream);
+
+    free(cache.path);
+    free(cache.hot);
+
+    cache.path = NULL;
+    cache.hot = NULL;
+    cache.stream = NULL;
+    cache.map = NULL;
+}
@@ -0,0 +1,46 @@
+#ifndef FVMR_CACHE_H
+
+#define FVMR_CACHE_H
+
+#include <string.h>
+#include "global.h"
+#include "decoder.h"
+#include "block.h"
+#include "jit.h"
+
+#define FVM_CACHE "hardware/cache" // The cache directory used by --cache without a directory
+#define CACHE_MAGIC UINT64_C(0x314843414352564d) // "MVRCACH1" at the start of every cache file
+
+struct cache_header { // Start of a cache file, which is followed by the decoded stream and then the hot block bitmap
+    uint64_t magic, // CACHE_MAGIC
+             key, // cache.key when the file was written, which is also its name
+             rom_length, // Cells in the ROM
+             decoded_length, // Slots in the decoded stream
+             extent; // decoder.extent after decoding at load
+};
+
+extern struct fvmr_cache { // Decoded streams and hot block sets kept across runs, keyed by a hash of the ROM and the runtime build
+    char *path; // File holding the cache for this ROM (NULL if there is no cache in use)
+    uint64_t key, // Hash of the ROM, the runtime's version and build, and the decoder's settings
+             length, // Cells in the ROM, since Main Memory can grow while it runs
+             extent, // decoder.extent straight after decoding at load
+             *hot, // Bitmap of addresses in the ROM whose blocks have been translated by the jit engine, in this run or earlier ones
+             hot_size; // Words in hot
+    const struct decoded_instruction *stream; // The decoded stream as it was straight after decoding at load, written out on exit
+    void *map; // The cache file, mapped when it was found
+    size_t map_size;
+    _Bool hit, // If the decoded stream came from the cache rather than decoding at load
+          dirty; // If the cache file needs writing out on exit
+} cache;
+
+extern _Bool cache_load(const char *directory); // Fill the decoded stream from the cache for the ROM in Main Memory, once it's loaded. Returns 1 if it has to be decoded instead (including when directory is NULL, for no cache)
+extern void cache_keep(void); // Remember the decoded stream straight after decoder_init(), so that it can be written out on exit
+extern void cache_save(void); // Write the decoded stream and every block that got hot in this run to the cache
+extern void cache_report(void); // Print whether the cache was hit and how many blocks started out hot
+extern void cache_end(void); // Cleanup
+
+static inline _Bool cache_is_hot(uint64_t address) { // If the block at address got hot in an earlier run, so it's worth translating straight away
+    return cache.hot != NULL && address >> 6 < cache.hot_size && cache.hot[address >> 6] >> (address & 63) & 1;
+}
+
+#endif
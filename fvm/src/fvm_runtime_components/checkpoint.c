@@ -0,0 +1,336 @@
+/* Fox Virtual Machine: Checkpoints
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// A checkpoint is written by a child forked at the moment it's taken, which sees the VM frozen as it was, copy-on-write,
+// while the VM carries on in the parent. Only the chunks of Main Memory that aren't all zero are stored, and resuming
+// copies just those into zeroed memory, so that a large, mostly untouched address range costs next to nothing either way.
+
+#include "checkpoint.h"
+#include "service.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct fvmr_checkpoint checkpoint = {
+    .path = NULL,
+    .every = 0,
+    .taken = 0,
+    .next = UINT64_MAX,
+    .requested = 0,
+    .writer = 0,
+    .disk_offset = -1,
+    .keypresses = NULL,
+    .keypresses_length = 0
+};
+
+static void checkpoint_signal(int signal) { // SIGUSR1 handler, which has one taken at the engine's next chance
+    (void)signal;
+
+    atomic_store(&checkpoint.requested, 1);
+
+    service_interrupt();
+}
+
+void checkpoint_init(const char *path, uint64_t every) { // Start taking checkpoints
+    struct sigaction action = {.sa_handler = checkpoint_signal, .sa_flags = SA_RESTART};
+
+    checkpoint.path = path;
+    checkpoint.every = every;
+
+    checkpoint.next = every ? every : UINT64_MAX;
+
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR1, &action, NULL);
+
+    service_schedule();
+}
+
+static _Bool checkpoint_write_chunk(FILE *f, struct checkpoint_header *header, uint64_t index, const uint64_t *cells) { // Write the chunk at index, unless it's all zero, returns 1 on failure
+    static const uint64_t zero[CHECKPOINT_CHUNK] = {0};
+
+    if(!memcmp(cells, zero, sizeof(zero))) // Left out, and zeroed again on resume
+        return 0;
+
+    header->chunks++;
+
+    return fwrite(&index, sizeof(index), 1, f) != 1 || fwrite(cells, sizeof(uint64_t), CHECKPOINT_CHUNK, f) != CHECKPOINT_CHUNK;
+}
+
+static _Bool checkpoint_write(FILE *f, struct checkpoint_header *header) { // Write the checkpoint to f, counting the chunks into header, returns 1 on failure
+    struct paged_chunk **chunks;
+    uint64_t cells,
+             length,
+             address,
+             last[CHECKPOINT_CHUNK];
+
+    if(fwrite(header, sizeof(*header), 1, f) != 1
+       || fwrite(fvmkbd.keypress_queue, sizeof(struct fvmkbd_keypress), header->keypresses, f) != header->keypresses
+       || fwrite(files[CST].self, sizeof(uint64_t), header->callstack_length, f) != header->callstack_length)
+        return 1;
+
+    for(uint64_t i = 0; i * CHECKPOINT_CHUNK < files[MEM].length; i++) {
+        if((cells = files[MEM].length - i * CHECKPOINT_CHUNK) >= CHECKPOINT_CHUNK) {
+            if(checkpoint_write_chunk(f, header, i, &files[MEM].self[i * CHECKPOINT_CHUNK]))
+                return 1;
+
+            continue;
+        }
+
+        memcpy(last, &files[MEM].self[i * CHECKPOINT_CHUNK], cells * sizeof(uint64_t));
+
+        for(uint64_t j = cells; j < CHECKPOINT_CHUNK; j++) // The last chunk is filled out from paged memory, so that every chunk is the same size
+            last[j] = paged_load(&paged, i * CHECKPOINT_CHUNK + j);
+
+        if(checkpoint_write_chunk(f, header, i, last))
+            return 1;
+    }
+
+    if((length = paged_sorted(&paged, &chunks)) < paged.length) // Followed by the pages of paged memory that were written to
+        return 1;
+
+    for(uint64_t i = 0; i < length; i++) {
+        for(uint64_t j = 0; j < PAGED_CHUNK_PAGES; j++) {
+            address = chunks[i]->index << PAGED_CHUNK_SHIFT | j << PAGED_PAGE_SHIFT;
+
+            if(!(chunks[i]->touched[j >> 6] & (uint64_t)1 << (j & 63)) || address < files[MEM].length) // Never written to, or in Main Memory now and so stored above
+                continue;
+
+            if(checkpoint_write_chunk(f, header, address / CHECKPOINT_CHUNK, &chunks[i]->cells[j << PAGED_PAGE_SHIFT])) {
+                free(chunks);
+
+                return 1;
+            }
+        }
+    }
+
+    free(chunks);
+
+    rewind(f); // The header goes back in with the number of chunks, now that it's known
+
+    return fwrite(header, sizeof(*header), 1, f) != 1;
+}
+
+void checkpoint_take(uint64_t cea, uint64_t executed) { // Write a checkpoint from a forked process
+    struct checkpoint_header header = {
+        .magic = CHECKPOINT_MAGIC,
+        .memory_length = files[MEM].length,
+        .chunks = 0,
+        .callstack_length = files[CST].length,
+        .keypresses = fvmkbd.keypress_queue != NULL ? fvmkbd.keypress_queue_length : 0,
+        .heap_base = heap.base,
+        .heap_top = heap.top,
+        .disk_offset = disk != NULL ? ftell(disk) : -1 // Read here, since the child shares the file offset with this process as it carries on
+    };
+    char *temporary;
+    FILE *f;
+    pid_t pid;
+
+    checkpoint.next = checkpoint.every ? executed + checkpoint.every : UINT64_MAX;
+
+    if(checkpoint.writer > 0) // Only one is written at a time, so that they're finished in order
+        waitpid(checkpoint.writer, NULL, 0);
+
+    checkpoint.writer = 0;
+
+    memcpy(header.registers, fvm_registers, sizeof(header.registers));
+    memcpy(header.heap_free, heap.free, sizeof(header.heap_free));
+
+    header.registers[CEA] = cea;
+
+    if(disk != NULL)
+        fflush(disk);
+
+    fflush(NULL); // So that the child doesn't write out anything still buffered a second time
+
+    if((pid = fork()) < 0) {
+        perror("fvmr -> Could not start writing checkpoint");
+
+        return;
+    }
+
+    if(pid) {
+        checkpoint.writer = pid;
+        checkpoint.taken++;
+
+        return;
+    }
+
+    // In the child, written to a temporary file which replaces the checkpoint only once it's complete:
+
+    if((temporary = malloc(strlen(checkpoint.path) + 5)) == NULL)
+        _exit(1);
+
+    sprintf(temporary, "%s.tmp", checkpoint.path);
+
+    if((f = fopen(temporary, "wb")) == NULL) {
+        perror("fvmr -> Could not write checkpoint");
+
+        _exit(1);
+    }
+
+    if(checkpoint_write(f, &header) | fclose(f) || rename(temporary, checkpoint.path)) {
+        perror("fvmr -> Could not write checkpoint");
+
+        remove(temporary);
+
+        _exit(1);
+    }
+
+    _exit(0);
+}
+
+_Bool checkpoint_resume(const char *path) { // Load the VM from the checkpoint at path
+    const struct checkpoint_header *header;
+    const uint64_t *cursor;
+    uint64_t address,
+             cells;
+    struct stat status;
+    void *map;
+    int fd;
+
+    if((fd = open(path, O_RDONLY)) < 0) {
+        perror("fvmr -> Could not access checkpoint");
+
+        return 1;
+    }
+
+    if(fstat(fd, &status) || (size_t)status.st_size < sizeof(*header) || (map = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+        fprintf(stderr, "fvmr -> Could not read checkpoint\n");
+
+        close(fd);
+
+        return 1;
+    }
+
+    close(fd);
+
+    header = map;
+
+    if(header->magic != CHECKPOINT_MAGIC
+       || !header->memory_length
+       || header->chunks > (uint64_t)status.st_size / ((CHECKPOINT_CHUNK + 1) * sizeof(uint64_t))
+       || (uint64_t)status.st_size != sizeof(*header) + header->keypresses * sizeof(struct fvmkbd_keypress) + header->callstack_length * sizeof(uint64_t) + header->chunks * (CHECKPOINT_CHUNK + 1) * sizeof(uint64_t)) {
+        fprintf(stderr, "fvmr -> Found checkpoint to be corrupt!\n");
+
+        munmap(map, status.st_size);
+
+        return 1;
+    }
+
+    memcpy(fvm_registers, header->registers, sizeof(fvm_registers));
+    memcpy(heap.free, header->heap_free, sizeof(heap.free));
+
+    heap.base = header->heap_base;
+    heap.top = header->heap_top;
+
+    checkpoint.disk_offset = header->disk_offset;
+    checkpoint.keypresses_length = header->keypresses;
+
+    if(header->keypresses) {
+        if((checkpoint.keypresses = malloc(header->keypresses * sizeof(struct fvmkbd_keypress))) == NULL) {
+            perror("fvmr -> Could not allocate memory for keypress queue");
+
+            munmap(map, status.st_size);
+
+            return 1;
+        }
+
+        memcpy(checkpoint.keypresses, header + 1, header->keypresses * sizeof(struct fvmkbd_keypress));
+    }
+
+    cursor = (const uint64_t *)((const struct fvmkbd_keypress *)(header + 1) + header->keypresses);
+
+    if(header->callstack_length > files[CST].size) {
+        if((alloc_buff = realloc(files[CST].self, header->callstack_length * sizeof(uint64_t))) == NULL) {
+            perror("fvmr -> Could not allocate memory for Callstack");
+
+            munmap(map, status.st_size);
+
+            return 1;
+        }
+
+        files[CST].self = (uint64_t *)alloc_buff;
+        files[CST].size = header->callstack_length;
+    }
+
+    memcpy(files[CST].self, cursor, header->callstack_length * sizeof(uint64_t));
+
+    files[CST].length = header->callstack_length;
+    cursor += header->callstack_length;
+
+    if((files[MEM].self = calloc(header->memory_length, sizeof(uint64_t))) == NULL) { // Untouched, apart from the chunks copied in below
+        perror("fvmr -> Could not allocate memory for Main Memory");
+
+        munmap(map, status.st_size);
+
+        return 1;
+    }
+
+    files[MEM].size = files[MEM].length = header->memory_length;
+
+    for(uint64_t i = 0; i < header->chunks; i++, cursor += CHECKPOINT_CHUNK + 1) {
+        if(cursor[0] > UINT64_MAX / CHECKPOINT_CHUNK) {
+            fprintf(stderr, "fvmr -> Found checkpoint to be corrupt!\n");
+
+            munmap(map, status.st_size);
+
+            return 1;
+        }
+
+        address = cursor[0] * CHECKPOINT_CHUNK;
+        cells = address >= files[MEM].length ? 0 : files[MEM].length - address < CHECKPOINT_CHUNK ? files[MEM].length - address : CHECKPOINT_CHUNK;
+
+        memcpy(&files[MEM].self[address], cursor + 1, cells * sizeof(uint64_t));
+
+        for(uint64_t j = cells; j < CHECKPOINT_CHUNK; j++) { // Anything past the end of Main Memory goes back into paged memory
+            if(cursor[1 + j] && paged_write(&paged, address + j, cursor[1 + j])) {
+                perror("fvmr -> Could not allocate memory for paged memory");
+
+                munmap(map, status.st_size);
+
+                return 1;
+            }
+        }
+    }
+
+    munmap(map, status.st_size);
+
+    return 0;
+}
+
+void checkpoint_resume_devices(void) { // Put the disk and keypress queue back
+    if(disk != NULL && checkpoint.disk_offset >= 0)
+        fseek(disk, checkpoint.disk_offset, SEEK_SET);
+
+    for(uint64_t i = 0; i < checkpoint.keypresses_length; i++)
+        fvmkbd_enqueue_keypress(checkpoint.keypresses[i]);
+}
+
+void checkpoint_report(void) { // Print how many checkpoints were taken
+    if(checkpoint.path == NULL)
+        return;
+
+    fprintf(stderr, "\tCheckpoints taken: %zu\n", checkpoint.taken);
+}
+
+void checkpoint_end(void) { // Wait for the last checkpoint, and cleanup
+    if(checkpoint.writer > 0)
+        waitpid(checkpoint.writer, NULL, 0);
+
+    checkpoint.writer = 0;
+
+    free(checkpoint.keypresses);
+
+    checkpoint.keypresses = NULL;
+    checkpoint.keypresses_length = 0;
+}
@@ -0,0 +1,50 @@
+#ifndef FVMR_CHECKPOINT_H
+
+#define FVMR_CHECKPOINT_H
+
+#include <stdatomic.h>
+#include <sys/types.h>
+#include "global.h"
+#include "fvmkbd.h"
+#include "paged.h"
+#include "heap.h"
+
+#define FVM_CHECKPOINT "hardware/checkpoint" // The checkpoint file used by --checkpoint without a file
+#define CHECKPOINT_MAGIC UINT64_C(0x3254504b4352564d) // "MVRCKPT2" at the start of every checkpoint file
+#define CHECKPOINT_CHUNK 512 // Cells in each chunk of Main Memory (a 4KiB page), which is only stored if it isn't all zero
+
+_Static_assert(CHECKPOINT_CHUNK == (uint64_t)1 << PAGED_PAGE_SHIFT, "Pages of paged memory are stored as chunks");
+
+struct checkpoint_header { // Start of a checkpoint file, which is followed by the keypress queue, the Callstack, and then each stored chunk of Main Memory as its index followed by its cells, in order of address (with the chunks past memory_length being paged memory)
+    uint64_t magic, // CHECKPOINT_MAGIC
+             registers[NO_REGISTERS], // With CEA on the instruction to carry on from
+             memory_length, // Cells in Main Memory
+             chunks, // Number of chunks of Main Memory and paged memory stored, the rest being all zero
+             callstack_length, // Cells in the Callstack
+             keypresses, // Length of the keypress queue
+             heap_base, // The heap allocator (whose blocks are in Main Memory)
+             heap_top,
+             heap_free[HEAP_CLASSES];
+    int64_t disk_offset; // Position in the disk (-1 if there was no disk)
+};
+
+extern struct fvmr_checkpoint { // Checkpoints of the running VM, taken on SIGUSR1 or every so many instructions, and resumed from with --resume=
+    const char *path; // File to write checkpoints to (NULL if they aren't being taken)
+    uint64_t every, // Instructions between checkpoints (0 for only on SIGUSR1)
+             taken, // Number of checkpoints written so far
+             next; // Instructions into the run when the next checkpoint is due (UINT64_MAX if none is)
+    _Atomic _Bool requested; // If SIGUSR1 has asked for one
+    pid_t writer; // Process writing out the last checkpoint (0 for none)
+    int64_t disk_offset; // Position in the disk to resume from
+    struct fvmkbd_keypress *keypresses; // Keypress queue to resume with
+    uint64_t keypresses_length;
+} checkpoint;
+
+extern void checkpoint_init(const char *path, uint64_t every); // Start taking checkpoints to path on SIGUSR1, and every so many instructions unless every is 0
+extern void checkpoint_take(uint64_t cea, uint64_t executed); // Write a checkpoint of the VM from a forked process, with cea as the instruction to carry on from (called through service_run(), once an engine has written its registers back to fvm_registers)
+extern _Bool checkpoint_resume(const char *path); // Load the registers, Main Memory and Callstack from the checkpoint at path instead of the ROM, returns 1 on failure
+extern void checkpoint_resume_devices(void); // Put the disk and keypress queue back as they were in the checkpoint, once they're set up
+extern void checkpoint_report(void); // Print how many checkpoints were taken
+extern void checkpoint_end(void); // Wait for the last checkpoint to be written out, and cleanup
+
+#endif
@@ -0,0 +1,426 @@
+/* Fox Virtual Machine: Instruction Decoder and Verifier
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// The threaded engine doesn't execute Main Memory directly, but a decoded copy of it, where every check that instructions[]
+// makes while executing (unknown opcodes, unknown registers, jumps outside of Main Memory) has already been made. At load, everything
+// reachable from where execution starts is decoded ahead of time. Anything else (the targets of rt, or of writes to CEA, anything that a
+// store has since modified, and anything that couldn't be decoded at load) is decoded the first time it's dispatched, which
+// is when an instruction that can't be decoded is reported. A guest can write code before jumping to it, or patch a bad
+// cell before it runs, so only fvmc, which has to know every instruction ahead of time, treats those cells as errors.
+
+#include "decoder.h"
+
+#define NO_OPCODES 28 // Opcodes that can be decoded, including fi
+
+const uint8_t DECODER_LENGTHS[NO_OPCODES] = { // Number of cells covered by each opcode
+    [0] = 3, // pl <value> <register>
+    [1] = 3, // mv <register> <register>
+    [2] = 1, // st
+    [3] = 1, // ld
+    [4] = 2, // jm <address>
+    [5] = 2, // js <address>
+    [6] = 2, // jc <address>
+    [7] = 1, [8] = 1, [9] = 1, [10] = 1, [11] = 1, [12] = 1, [13] = 1, // a+ a- a! ai ad a* a/
+    [14] = 1, [15] = 1, [16] = 1, [17] = 1, [18] = 1, // a& a| a^ al ar
+    [19] = 1, [20] = 1, [21] = 1, [22] = 1, [23] = 1, [24] = 1, // gt lt ge le eq ne
+    [25] = 2, // cl <address>
+    [26] = 1, // rt
+    [27] = 1 // fi
+};
+
+const char *FUSED_OP_NAMES[NO_FUSED_OPS] = {
+    [DECODED_PLACE_DAT_ADD - DECODED_FIRST_FUSED] = "pl <value> dat; a+",
+    [DECODED_PLACE_DAT_SUB - DECODED_FIRST_FUSED] = "pl <value> dat; a-",
+    [DECODED_PLACE_DAT_MUL - DECODED_FIRST_FUSED] = "pl <value> dat; a*",
+    [DECODED_GT_JUMP_IF_SET - DECODED_FIRST_FUSED] = "gt; js <address>",
+    [DECODED_GT_JUMP_IF_CLEAR - DECODED_FIRST_FUSED] = "gt; jc <address>",
+    [DECODED_LT_JUMP_IF_SET - DECODED_FIRST_FUSED] = "lt; js <address>",
+    [DECODED_LT_JUMP_IF_CLEAR - DECODED_FIRST_FUSED] = "lt; jc <address>",
+    [DECODED_GE_JUMP_IF_SET - DECODED_FIRST_FUSED] = "ge; js <address>",
+    [DECODED_GE_JUMP_IF_CLEAR - DECODED_FIRST_FUSED] = "ge; jc <address>",
+    [DECODED_LE_JUMP_IF_SET - DECODED_FIRST_FUSED] = "le; js <address>",
+    [DECODED_LE_JUMP_IF_CLEAR - DECODED_FIRST_FUSED] = "le; jc <address>",
+    [DECODED_EQ_JUMP_IF_SET - DECODED_FIRST_FUSED] = "eq; js <address>",
+    [DECODED_EQ_JUMP_IF_CLEAR - DECODED_FIRST_FUSED] = "eq; jc <address>",
+    [DECODED_NE_JUMP_IF_SET - DECODED_FIRST_FUSED] = "ne; js <address>",
+    [DECODED_NE_JUMP_IF_CLEAR - DECODED_FIRST_FUSED] = "ne; jc <address>",
+    [DECODED_PLACE_MCH_STORE - DECODED_FIRST_FUSED] = "pl <value> mch; st",
+    [DECODED_PLACE_MCH_LOAD - DECODED_FIRST_FUSED] = "pl <value> mch; ld",
+    [DECODED_PLACE_MAR_STORE - DECODED_FIRST_FUSED] = "pl <value> mar; st",
+    [DECODED_PLACE_MAR_LOAD - DECODED_FIRST_FUSED] = "pl <value> mar; ld",
+    [DECODED_PLACE_MDR_STORE - DECODED_FIRST_FUSED] = "pl <value> mdr; st"
+};
+
+struct fvmr_decoder decoder = {
+    .code = NULL,
+    .length = 0,
+    .extent = 0,
+    .fuse = 1,
+    .quicken = 1
+};
+
+static _Bool decoder_error(uint64_t address, enum decoder_reporting reporting, const char *format, ...) { // Report an instruction that can't be decoded, returns 1 for convenience
+    va_list args;
+
+    if(reporting == DECODER_QUIET)
+        return 1;
+
+    if(reporting == DECODER_VERIFYING) // Errors found at load say where they are, since CEA isn't there to point at them
+        fprintf(stderr, "fvmr -> Verifier -> Address %zu: ", address);
+    else
+        fprintf(stderr, "fvmr -> ");
+
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+
+    fputc('\n', stderr);
+
+    return 1;
+}
+
+static _Bool decoder_is_local(uint64_t reg) { // If the threaded engine keeps the register in a local rather than in fvm_registers
+    return reg == ACC || reg == DAT || reg == CEA;
+}
+
+static void decoder_fuse(uint64_t address, struct decoded_instruction *slot) { // Merge the instruction after the one in slot into it, if the pair has a fused form
+    uint64_t *mem = files[MEM].self,
+             next = address + slot->length;
+
+    if(next >= files[MEM].length) // There has to be a next instruction to fuse with
+        return;
+
+    switch(slot->op) {
+        case DECODED_PLACE_DAT: // pl <value> dat, followed by a+, a- or a*
+            switch(mem[next]) {
+                case 7: // a+
+                    slot->op = DECODED_PLACE_DAT_ADD;
+                    break;
+                case 8: // a-
+                    slot->op = DECODED_PLACE_DAT_SUB;
+                    break;
+                case 12: // a*
+                    slot->op = DECODED_PLACE_DAT_MUL;
+                    break;
+                default:
+                    return;
+            }
+
+            slot->length++;
+
+            return;
+        case DECODED_PLACE: // pl <value> mch/mar, followed by st or ld, or pl <value> mdr followed by st
+            if(mem[next] != 2 && mem[next] != 3)
+                return;
+
+            switch(slot->reg[0]) {
+                case MCH:
+                    slot->op = mem[next] == 2 ? DECODED_PLACE_MCH_STORE : DECODED_PLACE_MCH_LOAD;
+                    break;
+                case MAR:
+                    slot->op = mem[next] == 2 ? DECODED_PLACE_MAR_STORE : DECODED_PLACE_MAR_LOAD;
+                    break;
+                case MDR:
+                    if(mem[next] != 2)
+                        return;
+
+                    slot->op = DECODED_PLACE_MDR_STORE;
+                    break;
+                default:
+                    return;
+            }
+
+            slot->length++;
+
+            return;
+        case DECODED_ACCUMULATOR_GT: // A compare, followed by js or jc to somewhere inside Main Memory
+        case DECODED_ACCUMULATOR_LT:
+        case DECODED_ACCUMULATOR_GE:
+        case DECODED_ACCUMULATOR_LE:
+        case DECODED_ACCUMULATOR_EQ:
+        case DECODED_ACCUMULATOR_NE:
+            if((mem[next] != 5 && mem[next] != 6) || next + 1 >= files[MEM].length || mem[next + 1] >= files[MEM].length)
+                return;
+
+            slot->operand = mem[next + 1];
+            slot->op = DECODED_GT_JUMP_IF_SET + 2 * (slot->op - DECODED_ACCUMULATOR_GT) + (mem[next] == 6);
+            slot->length += 2;
+    }
+}
+
+_Bool decoder_decode(uint64_t address, enum decoder_reporting reporting) { // Decode the instruction at address into its slot
+    uint64_t *mem = files[MEM].self,
+             opcode;
+    struct decoded_instruction slot = {0};
+
+    if(address >= files[MEM].length)
+        return decoder_error(address, reporting, "Execution ran past the end of Main Memory at address '%zu'", address);
+
+    if((opcode = mem[address]) >= NO_OPCODES)
+        return decoder_error(address, reporting, "Encountered unknown instruction '%zu'", opcode);
+
+    slot.length = DECODER_LENGTHS[opcode];
+
+    if(files[MEM].length - address < slot.length)
+        return decoder_error(address, reporting, "Instruction '%zu' is missing operands at the end of Main Memory", opcode);
+
+    switch(opcode) {
+        case 0: // pl <value> <register>
+            if(mem[address + 2] >= NO_REGISTERS)
+                return decoder_error(address, reporting, "Attempted to place value into unknown register '%zu'", mem[address + 2]);
+
+            slot.operand = mem[address + 1];
+            slot.reg[0] = mem[address + 2];
+
+            switch(slot.reg[0]) {
+                case ACC:
+                    slot.op = DECODED_PLACE_ACC;
+                    break;
+                case DAT:
+                    slot.op = DECODED_PLACE_DAT;
+                    break;
+                case CEA: // Placing into CEA jumps to the value + 3, once pl and the execution cycle have both moved it along
+                    if(slot.operand + 3 >= files[MEM].length)
+                        return decoder_error(address, reporting, "Attempted to jump to address '%zu' outside of Main Memory", slot.operand + 3);
+
+                    slot.op = DECODED_PLACE_CEA;
+                    break;
+                default:
+                    slot.op = DECODED_PLACE;
+            }
+
+            break;
+        case 1: // mv <register> <register>
+            if(mem[address + 2] >= NO_REGISTERS)
+                return decoder_error(address, reporting, "Attempted to move register's value into unknown register '%zu'", mem[address + 2]);
+
+            if(mem[address + 1] >= NO_REGISTERS)
+                return decoder_error(address, reporting, "Attempted to move value in unknown register '%zu' into another register", mem[address + 1]);
+
+            slot.reg[0] = mem[address + 1];
+            slot.reg[1] = mem[address + 2];
+
+            if(!decoder_is_local(slot.reg[0]) && !decoder_is_local(slot.reg[1]))
+                slot.op = DECODED_MOVE;
+            else if(!decoder_is_local(slot.reg[0]) && slot.reg[1] == ACC)
+                slot.op = DECODED_MOVE_TO_ACC;
+            else if(slot.reg[0] == ACC && !decoder_is_local(slot.reg[1]))
+                slot.op = DECODED_MOVE_FROM_ACC;
+            else
+                slot.op = DECODED_MOVE_ANY;
+
+            break;
+        case 2: // st
+            slot.op = slot.reg[0] = DECODED_STORE;
+            break;
+        case 3: // ld
+            slot.op = slot.reg[0] = DECODED_LOAD;
+            break;
+        case 4: // jm <address>
+        case 5: // js <address>
+        case 6: // jc <address>
+        case 25: // cl <address>
+            if((slot.operand = mem[address + 1]) >= files[MEM].length)
+                return decoder_error(address, reporting, "Attempted to jump to address '%zu' outside of Main Memory", slot.operand);
+
+            slot.op = opcode == 4 ? DECODED_JUMP :
+                      opcode == 5 ? DECODED_JUMP_IF_SET :
+                      opcode == 6 ? DECODED_JUMP_IF_CLEAR :
+                      DECODED_CALL;
+            break;
+        case 26: // rt
+            slot.op = DECODED_RETURN;
+            break;
+        case 27: // fi
+            slot.op = DECODED_FINISH;
+            break;
+        default: // The ALU operations, whose opcodes are in the same order as their decoded counterparts
+            slot.op = DECODED_ACCUMULATOR_ADD + (opcode - 7);
+    }
+
+    if(decoder.fuse)
+        decoder_fuse(address, &slot);
+
+    decoder.code[address] = slot;
+
+    if(address + slot.length > decoder.extent)
+        decoder.extent = address + slot.length;
+
+    return 0;
+}
+
+_Bool decoder_init(_Bool verifying) { // Allocate the decoded stream and decode everything reachable from CEA and the Callstack
+    uint64_t *pending, // Addresses yet to be verified
+             pending_size = ALLOC_SIZE + files[CST].length + 1,
+             pending_length = 0,
+             address,
+             errors = 0;
+    uint8_t *visited;
+    struct decoded_instruction *slot;
+
+    decoder.length = files[MEM].length + 1;
+
+    if((decoder.code = calloc(decoder.length, sizeof(struct decoded_instruction))) == NULL) {
+        perror("fvmr -> Could not allocate memory for decoded instructions");
+
+        return 1;
+    }
+
+    if((visited = calloc(files[MEM].length, sizeof(uint8_t))) == NULL || (pending = calloc(pending_size, sizeof(uint64_t))) == NULL) {
+        perror("fvmr -> Could not allocate memory for verifier");
+
+        free(visited);
+
+        return 1;
+    }
+
+    // Execution carries on from CEA (0 at boot, or wherever a resumed checkpoint or a fork server's snapshot left off),
+    // and then from just after each call on the Callstack, as they return. Decoding from address 0 instead would decode
+    // Main Memory as the guest has since left it, as though it were the ROM.
+
+    if(fvm_registers[CEA] < files[MEM].length)
+        pending[pending_length++] = fvm_registers[CEA];
+
+    for(uint64_t i = 0; i < files[CST].length; i++)
+        if(files[CST].self[i] + 2 < files[MEM].length) // Past the cl and its operand
+            pending[pending_length++] = files[CST].self[i] + 2;
+
+    while(pending_length) { // Follow every path through the ROM
+        address = pending[--pending_length];
+
+        if(visited[address])
+            continue;
+
+        visited[address] = 1;
+
+        if(decoder_decode(address, verifying ? DECODER_VERIFYING : DECODER_QUIET)) { // (Left undecoded otherwise, to be reported if it's ever run)
+            errors += verifying;
+
+            continue;
+        }
+
+        slot = &decoder.code[address];
+
+        if(pending_length + 2 > pending_size) { // Make room for this instruction's successors
+            pending_size += ALLOC_SIZE;
+
+            if((alloc_buff = (void *)realloc(pending, pending_size * sizeof(uint64_t))) == NULL) {
+                perror("fvmr -> Could not allocate memory for verifier");
+
+                free(pending);
+                free(visited);
+
+                return 1;
+            }
+
+            pending = (uint64_t *)alloc_buff;
+        }
+
+        switch(slot->op) { // Queue up wherever execution can go next
+            case DECODED_JUMP:
+                pending[pending_length++] = slot->operand;
+                continue;
+            case DECODED_PLACE_CEA:
+                pending[pending_length++] = slot->operand + 3;
+                continue;
+            case DECODED_JUMP_IF_SET:
+            case DECODED_JUMP_IF_CLEAR:
+            case DECODED_CALL: // Calls return to just after themselves
+            case DECODED_GT_JUMP_IF_SET:
+            case DECODED_GT_JUMP_IF_CLEAR:
+            case DECODED_LT_JUMP_IF_SET:
+            case DECODED_LT_JUMP_IF_CLEAR:
+            case DECODED_GE_JUMP_IF_SET:
+            case DECODED_GE_JUMP_IF_CLEAR:
+            case DECODED_LE_JUMP_IF_SET:
+            case DECODED_LE_JUMP_IF_CLEAR:
+            case DECODED_EQ_JUMP_IF_SET:
+            case DECODED_EQ_JUMP_IF_CLEAR:
+            case DECODED_NE_JUMP_IF_SET:
+            case DECODED_NE_JUMP_IF_CLEAR:
+                pending[pending_length++] = slot->operand;
+                break;
+            case DECODED_MOVE_ANY:
+                if(slot->reg[1] == CEA) // Where this goes can only be known at runtime
+                    continue;
+
+                break;
+            case DECODED_RETURN:
+            case DECODED_FINISH:
+                continue;
+        }
+
+        if(address + slot->length >= files[MEM].length) { // Everything else carries on to the next instruction, which has to exist (by the time it's run)
+            errors += decoder_error(address, verifying ? DECODER_VERIFYING : DECODER_QUIET, "Execution runs past the end of Main Memory");
+
+            continue;
+        }
+
+        pending[pending_length++] = address + slot->length;
+    }
+
+    free(pending);
+    free(visited);
+
+    if(errors) {
+        fprintf(stderr, "fvmr -> Verifier -> ROM failed verification with %zu error%s\n", errors, errors == 1 ? "" : "s");
+
+        return 1;
+    }
+
+    return 0;
+}
+
+_Bool decoder_resize(void) { // Grow the decoded stream to match Main Memory
+    uint64_t length = files[MEM].length + 1;
+
+    if(length <= decoder.length)
+        return 0;
+
+    if(length < decoder.length * 2) // Geometrically, so that growing Main Memory a cell at a time doesn't copy the stream each time
+        length = decoder.length * 2;
+
+    if((alloc_buff = (void *)realloc(decoder.code, length * sizeof(struct decoded_instruction))) == NULL) {
+        perror("fvmr -> Could not allocate memory for decoded instructions");
+
+        return 1;
+    }
+
+    decoder.code = (struct decoded_instruction *)alloc_buff;
+
+    memset(&decoder.code[decoder.length], 0, (length - decoder.length) * sizeof(struct decoded_instruction)); // New slots start undecoded
+
+    decoder.length = length;
+
+    return 0;
+}
+
+void decoder_report(void) { // Print how often each fused op was executed, and how many st/ld sites were quickened
+    if(decoder.code == NULL)
+        return;
+
+    fprintf(stderr,
+            "\tst/ld sites quickened: %zu\n"
+            "\tst/ld sites deoptimised: %zu\n",
+            decoder.quickened,
+            decoder.deoptimised);
+
+    fprintf(stderr, "\tFused instructions executed:\n");
+
+    for(uint64_t i = 0; i < NO_FUSED_OPS; i++)
+        if(decoder.fused[i])
+            fprintf(stderr, "\t\t%-20s %zu\n", FUSED_OP_NAMES[i], decoder.fused[i]);
+}
+
+void decoder_end(void) { // Cleanup
+    free(decoder.code);
+
+    decoder.code = NULL;
+    decoder.length = 0;
+    decoder.extent = 0;
+}
@@ -0,0 +1,174 @@
+#ifndef FVMR_DECODER_H
+
+#define FVMR_DECODER_H
+
+#include <stdarg.h>
+#include <string.h>
+#include "global.h"
+
+#define DECODER_MAX_LENGTH 4 // Most cells that one decoded slot can cover (a fused pl and st/ld/ALU operation)
+#define DECODER_QUICKEN_THRESHOLD 4 // Times in a row a st/ld site has to use the same channel before it's specialised to it
+
+enum decoded_op { // Operations in the decoded instruction stream
+    DECODED_UNDECODED = 0, // Not decoded yet (or invalidated by a store), decoded when it's next dispatched
+    DECODED_PLACE, // pl into a register in fvm_registers
+    DECODED_PLACE_ACC, // pl into ACC
+    DECODED_PLACE_DAT, // pl into DAT
+    DECODED_PLACE_CEA, // pl into CEA (a jump to the value + 3)
+    DECODED_MOVE, // mv between two registers in fvm_registers
+    DECODED_MOVE_TO_ACC, // mv from a register in fvm_registers to ACC
+    DECODED_MOVE_FROM_ACC, // mv from ACC to a register in fvm_registers
+    DECODED_MOVE_ANY, // Any other mv, including ones into CEA
+    DECODED_STORE, // st
+    DECODED_LOAD, // ld
+    DECODED_JUMP, // jm
+    DECODED_JUMP_IF_SET, // js
+    DECODED_JUMP_IF_CLEAR, // jc
+    DECODED_ACCUMULATOR_ADD, // a+ (this and the following ALU operations are in the same order as their opcodes)
+    DECODED_ACCUMULATOR_SUB, // a-
+    DECODED_ACCUMULATOR_NOT, // a!
+    DECODED_ACCUMULATOR_INCREMENT, // ai
+    DECODED_ACCUMULATOR_DECREMENT, // ad
+    DECODED_ACCUMULATOR_MUL, // a*
+    DECODED_ACCUMULATOR_DIV, // a/
+    DECODED_ACCUMULATOR_AND, // a&
+    DECODED_ACCUMULATOR_OR, // a|
+    DECODED_ACCUMULATOR_XOR, // a^
+    DECODED_ACCUMULATOR_LSH, // al
+    DECODED_ACCUMULATOR_RSH, // ar
+    DECODED_ACCUMULATOR_GT, // gt
+    DECODED_ACCUMULATOR_LT, // lt
+    DECODED_ACCUMULATOR_GE, // ge
+    DECODED_ACCUMULATOR_LE, // le
+    DECODED_ACCUMULATOR_EQ, // eq
+    DECODED_ACCUMULATOR_NE, // ne
+    DECODED_CALL, // cl
+    DECODED_RETURN, // rt
+    DECODED_FINISH, // fi
+    DECODED_STORE_MEM, // st, quickened for MCH = MEM (this and the following quickened ops fall back to st/ld if their channel doesn't match)
+    DECODED_LOAD_MEM, // ld, quickened for MCH = MEM
+    DECODED_STORE_CST, // st, quickened for MCH = CST
+    DECODED_LOAD_CST, // ld, quickened for MCH = CST
+    DECODED_STORE_OUT_STDIO, // st, quickened for MCH = OUT, MAR = 0
+    DECODED_LOAD_INP_STDIO, // ld, quickened for MCH = INP, MAR = 0
+    DECODED_STORE_OUT_DISK, // st, quickened for MCH = OUT, MAR = 1
+    DECODED_LOAD_OUT_DISK, // ld, quickened for MCH = OUT, MAR = 1
+    DECODED_PLACE_DAT_ADD, // pl <value> dat; a+ (this and everything after it is a fused pair of instructions)
+    DECODED_PLACE_DAT_SUB, // pl <value> dat; a-
+    DECODED_PLACE_DAT_MUL, // pl <value> dat; a*
+    DECODED_GT_JUMP_IF_SET, // gt; js <address> (this and the following compares are in the same order as their opcodes, each followed by js then jc)
+    DECODED_GT_JUMP_IF_CLEAR, // gt; jc <address>
+    DECODED_LT_JUMP_IF_SET, // lt; js <address>
+    DECODED_LT_JUMP_IF_CLEAR, // lt; jc <address>
+    DECODED_GE_JUMP_IF_SET, // ge; js <address>
+    DECODED_GE_JUMP_IF_CLEAR, // ge; jc <address>
+    DECODED_LE_JUMP_IF_SET, // le; js <address>
+    DECODED_LE_JUMP_IF_CLEAR, // le; jc <address>
+    DECODED_EQ_JUMP_IF_SET, // eq; js <address>
+    DECODED_EQ_JUMP_IF_CLEAR, // eq; jc <address>
+    DECODED_NE_JUMP_IF_SET, // ne; js <address>
+    DECODED_NE_JUMP_IF_CLEAR, // ne; jc <address>
+    DECODED_PLACE_MCH_STORE, // pl <value> mch; st
+    DECODED_PLACE_MCH_LOAD, // pl <value> mch; ld
+    DECODED_PLACE_MAR_STORE, // pl <value> mar; st
+    DECODED_PLACE_MAR_LOAD, // pl <value> mar; ld
+    DECODED_PLACE_MDR_STORE, // pl <value> mdr; st
+    NO_DECODED_OPS
+};
+
+#define DECODED_FIRST_FUSED DECODED_PLACE_DAT_ADD
+#define NO_FUSED_OPS (NO_DECODED_OPS - DECODED_FIRST_FUSED)
+
+extern const char *FUSED_OP_NAMES[NO_FUSED_OPS]; // Instruction sequences that each fused op stands for, for reporting
+
+enum decoder_reporting { // How decoder_decode() reports an instruction that can't be decoded
+    DECODER_RUNNING = 0, // As an execution error, when it's dispatched (which the traceback then points at)
+    DECODER_VERIFYING = 1, // As a verification error, with its address
+    DECODER_QUIET = 2 // Not at all, leaving it undecoded for whenever it's run
+};
+
+struct decoded_instruction { // One slot of the decoded stream, there being one slot per cell of Main Memory
+    uint64_t operand; // Value placed by pl, or the target address of a jump or call
+    uint16_t op; // enum decoded_op
+    uint8_t length, // Number of cells the instruction covers
+            reg[2]; // Register operands, already checked against NO_REGISTERS (pl: destination, mv: source and destination). For st/ld: the quickened op that the last accesses suited, and how many times running they've suited it
+};
+
+extern struct fvmr_decoder { // The decoded stream
+    struct decoded_instruction *code; // Slots, indexed by address (NULL if the engine in use doesn't decode)
+    uint64_t length, // Number of slots: one for every cell of Main Memory, plus one past the end which is never decoded
+             extent, // Address just past the last cell covered by any slot that has been decoded, so stores above it can skip invalidation
+             fused[NO_FUSED_OPS], // Number of times each fused op has been executed
+             quickened, // Number of st/ld sites that have been specialised to a channel
+             deoptimised; // Number of specialised sites that have fallen back to st/ld after seeing a different channel
+    _Bool fuse, // If pairs of instructions with a fused form should be decoded into it
+          quicken; // If st/ld sites should be specialised to the channel they use
+} decoder;
+
+extern _Bool decoder_init(_Bool verifying); // Allocate the decoded stream and decode everything reachable from CEA and the return addresses on the Callstack (just address 0, for a ROM that hasn't started). If verifying, every cell that can't be decoded is reported, and 1 is returned if there were any; otherwise they're left to be reported when they're run, and 1 is only returned if allocation failed
+extern _Bool decoder_decode(uint64_t address, enum decoder_reporting reporting); // Decode the instruction at address into its slot, returns 1 (having reported why, as reporting says) if it isn't a valid instruction
+extern _Bool decoder_resize(void); // Grow the decoded stream to match Main Memory after it has grown
+extern void decoder_report(void); // Print how often each fused op was executed, and how many st/ld sites were quickened
+extern void decoder_end(void); // Cleanup
+
+static inline void decoder_invalidate(uint64_t address) { // Forget every decoded slot that covers address, so that a modified instruction is decoded again before it next runs
+    if(address >= decoder.extent) // Nothing that high up has been decoded
+        return;
+
+    for(uint64_t i = address >= DECODER_MAX_LENGTH - 1 ? address - (DECODER_MAX_LENGTH - 1) : 0; i <= address; i++)
+        if(decoder.code[i].op != DECODED_UNDECODED && i + decoder.code[i].length > address)
+            decoder.code[i].op = DECODED_UNDECODED;
+}
+
+static inline uint16_t decoder_store_specialisation(void) { // The quickened form of st that suits the current MCH and MAR, or DECODED_STORE if there isn't one
+    switch(fvm_registers[MCH]) {
+        case MEM:
+            return DECODED_STORE_MEM;
+        case CST:
+            return DECODED_STORE_CST;
+        case OUT:
+            return fvm_registers[MAR] == 0 ? DECODED_STORE_OUT_STDIO :
+                   fvm_registers[MAR] == 1 ? DECODED_STORE_OUT_DISK :
+                   DECODED_STORE;
+        default:
+            return DECODED_STORE;
+    }
+}
+
+static inline uint16_t decoder_load_specialisation(void) { // The quickened form of ld that suits the current MCH and MAR, or DECODED_LOAD if there isn't one
+    switch(fvm_registers[MCH]) {
+        case MEM:
+            return DECODED_LOAD_MEM;
+        case CST:
+            return DECODED_LOAD_CST;
+        case INP:
+            return fvm_registers[MAR] == 0 ? DECODED_LOAD_INP_STDIO : DECODED_LOAD;
+        case OUT:
+            return fvm_registers[MAR] == 1 ? DECODED_LOAD_OUT_DISK : DECODED_LOAD;
+        default:
+            return DECODED_LOAD;
+    }
+}
+
+static inline void decoder_quicken(struct decoded_instruction *slot, uint16_t generic, uint16_t specialisation) { // Count another access of a st/ld site, specialising it once it's used the same channel enough times running
+    if(slot->reg[0] != specialisation) { // A different channel from last time starts the count again
+        slot->reg[0] = specialisation;
+        slot->reg[1] = 0;
+    }
+
+    if(specialisation != generic && ++slot->reg[1] >= DECODER_QUICKEN_THRESHOLD) {
+        slot->op = specialisation;
+
+        decoder.quickened++;
+    }
+}
+
+static inline void decoder_deoptimise(struct decoded_instruction *slot, uint16_t generic) { // Return a specialised st/ld site to its generic form, after it saw a channel it wasn't specialised for
+    slot->op = generic;
+    slot->reg[0] = generic;
+    slot->reg[1] = 0;
+
+    decoder.deoptimised++;
+}
+
+#endif
@@ -0,0 +1,320 @@
+/* Fox Virtual Machine: Fork Server
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// The snapshot is this process itself, stopped once the ROM gets to the point the jobs start from: fork() gives each job
+// the registers, Main Memory and Callstack as they were, copy-on-write, so starting a job costs a fork() rather than
+// loading and warming up the ROM again. The only state that isn't simply inherited is the disk, whose file offset would
+// otherwise be shared between every job, so each job opens its own and seeks to where the snapshot left off.
+
+#include "forkserver.h"
+
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct fvmr_fork_server fork_server = {
+    .jobs = NULL,
+    .length = 0,
+    .size = 0,
+    .instructions = 0,
+    .failed = 0,
+    .results = NULL,
+    .disk_offset = 0
+};
+
+static _Bool fork_server_add(char **fields, uint64_t no_fields) { // Add a job from the fields of its line, returns 1 on failure
+    struct fork_server_job *job;
+
+    if(fork_server.length == fork_server.size) {
+        if((alloc_buff = realloc(fork_server.jobs, (fork_server.size + ALLOC_SIZE) * sizeof(struct fork_server_job))) == NULL) {
+            perror("fvmr -> Could not allocate memory for jobs");
+
+            return 1;
+        }
+
+        fork_server.jobs = (struct fork_server_job *)alloc_buff;
+        fork_server.size += ALLOC_SIZE;
+    }
+
+    job = &fork_server.jobs[fork_server.length++];
+
+    *job = (struct fork_server_job){
+        .input = strdup(fields[0]),
+        .output = no_fields > 1 ? strdup(fields[1]) : NULL,
+        .disk = no_fields > 2 ? strdup(fields[2]) : NULL,
+        .pid = 0,
+        .status = 0
+    };
+
+    if(job->input == NULL || (no_fields > 1 && job->output == NULL) || (no_fields > 2 && job->disk == NULL)) {
+        perror("fvmr -> Could not allocate memory for jobs");
+
+        return 1;
+    }
+
+    return 0;
+}
+
+_Bool fork_server_init(const char *jobs) { // Read the job file
+    FILE *f;
+    char line[4096],
+         *fields[4];
+    uint64_t line_no = 0,
+             no_fields;
+
+    if((f = fopen(jobs, "r")) == NULL) {
+        perror("fvmr -> Could not access job file");
+
+        return 1;
+    }
+
+    while(fgets(line, sizeof(line), f) != NULL) {
+        line_no++;
+
+        if(!(no_fields = line_fields(line, fields, 4))) // Blank line or comment
+            continue;
+
+        if(no_fields > 3) {
+            fprintf(stderr, "fvmr -> Expected '<input> [<output> [<disk>]]' on line %zu of job file\n", line_no);
+
+            fclose(f);
+
+            return 1;
+        }
+
+        if(fork_server_add(fields, no_fields)) {
+            fclose(f);
+
+            return 1;
+        }
+    }
+
+    fclose(f);
+
+    if(!fork_server.length) {
+        fprintf(stderr, "fvmr -> Found job file to be empty!\n");
+
+        return 1;
+    }
+
+    if((fork_server.results = mmap(NULL, fork_server.length * sizeof(struct fork_server_result), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED) { // Shared, so that the jobs can write their results into it
+        perror("fvmr -> Could not allocate memory for job results");
+
+        fork_server.results = NULL;
+
+        return 1;
+    }
+
+    return 0;
+}
+
+_Bool fork_server_snapshot(uint64_t steps, uint64_t marker) { // Run the ROM up to the snapshot
+    struct timespec start;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if(!pinned_run_to(steps, marker)) { // It stopped on its own before getting there
+        if(fvmr_exit_code == FVMR_EXIT_SUCCESS) {
+            fprintf(stderr, "fvmr -> Reached fi before the snapshot could be taken\n");
+
+            fvmr_exit_code = FVMR_EXIT_FAILURE_EXECUTION;
+        }
+
+        return 1;
+    }
+
+    fork_server.seconds = elapsed(&start);
+    fork_server.instructions = fvmr_stats.instructions;
+    fork_server.disk_offset = ftell(disk);
+
+    return 0;
+}
+
+static void fork_server_job(uint64_t index, void (*run)(void)) { // Body of a job's process, which never returns
+    struct fork_server_job *job = &fork_server.jobs[index];
+    struct timespec start;
+
+    fvmr_stats = (struct fvmr_stats){0}; // Only count the job's own instructions
+
+    // The disk inherited from the fork server isn't closed, since that would move the file offset it shares with it:
+
+    if((disk = fopen(job->disk != NULL ? job->disk : FVM_DISK, "rb+")) == NULL) {
+        perror("fvmr -> Could not access Disk");
+
+        _exit(FVMR_EXIT_FAILURE_INITIAL_FILE_ACCESS);
+    }
+
+    fseek(disk, fork_server.disk_offset, SEEK_SET);
+
+    if((console_input = fopen(job->input, "rb")) == NULL) {
+        fprintf(stderr, "fvmr -> Could not access input '%s': ", job->input);
+        perror(NULL);
+
+        _exit(FVMR_EXIT_FAILURE_INITIAL_FILE_ACCESS);
+    }
+
+    if((console_output = job->output != NULL ? fopen(job->output, "wb") : NULL) == NULL && job->output != NULL) {
+        fprintf(stderr, "fvmr -> Could not access output '%s': ", job->output);
+        perror(NULL);
+
+        _exit(FVMR_EXIT_FAILURE_INITIAL_FILE_ACCESS);
+    }
+
+    fork_server.results[index].latency = elapsed(&job->forked);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    run();
+
+    fork_server.results[index].seconds = elapsed(&start);
+    fork_server.results[index].instructions = fvmr_stats.instructions;
+
+    if(fvmr_exit_code != FVMR_EXIT_SUCCESS) {
+        fprintf(stderr, "fvmr -> Job %zu (%s) failed:\n", index, job->input);
+
+        traceback();
+    }
+
+    fclose(disk);
+    fclose(console_input);
+
+    if(console_output != NULL)
+        fclose(console_output);
+
+    fflush(stderr);
+
+    _exit(fvmr_exit_code); // Without running the fork server's atexit handlers or flushing its buffers a second time
+}
+
+_Bool fork_server_run(uint64_t workers, void (*run)(void)) { // Fork a copy of the snapshot for each job
+    struct timespec start;
+    uint64_t started = 0,
+             running = 0;
+    long online;
+    pid_t pid;
+    int status;
+    _Bool failed = 0;
+
+    if(!workers)
+        workers = (online = sysconf(_SC_NPROCESSORS_ONLN)) > 0 ? (uint64_t)online : 1;
+
+    fflush(NULL); // So that the jobs don't inherit anything still to be written
+    fflush(disk);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while(running || (started < fork_server.length && !failed)) {
+        while(running < workers && started < fork_server.length && !failed) { // Keep up to workers jobs going at once
+            clock_gettime(CLOCK_MONOTONIC, &fork_server.jobs[started].forked);
+
+            if((pid = fork()) < 0) {
+                perror("fvmr -> Could not start job");
+
+                failed = 1;
+
+                break;
+            }
+
+            if(!pid)
+                fork_server_job(started, run);
+
+            fork_server.jobs[started++].pid = pid;
+            running++;
+        }
+
+        if(!running)
+            break;
+
+        if((pid = wait(&status)) < 0) {
+            perror("fvmr -> Lost track of jobs");
+
+            return 1;
+        }
+
+        for(uint64_t i = 0; i < started; i++) {
+            if(fork_server.jobs[i].pid == pid) {
+                fork_server.jobs[i].status = status;
+
+                fork_server.failed += !WIFEXITED(status) || WEXITSTATUS(status) != FVMR_EXIT_SUCCESS;
+
+                running--;
+
+                break;
+            }
+        }
+    }
+
+    fork_server.total = elapsed(&start);
+
+    fork_server.failed += fork_server.length - started; // Counting any that never got started
+
+    return failed && !started;
+}
+
+void fork_server_report(void) { // Print each job's exit code and startup latency, and the totals
+    double latency = 0;
+    uint64_t started = 0;
+
+    fprintf(stderr,
+            "fvmr -> Fork server:\n"
+            "\tJob\tExit code\tStartup latency\tInstructions\tTime\tInput\n");
+
+    for(uint64_t i = 0; i < fork_server.length; i++) {
+        if(!fork_server.jobs[i].pid) {
+            fprintf(stderr, "\t%zu\tnot started\t\t\t\t%s\n", i, fork_server.jobs[i].input);
+
+            continue;
+        }
+
+        started++;
+        latency += fork_server.results[i].latency;
+
+        if(WIFEXITED(fork_server.jobs[i].status))
+            fprintf(stderr, "\t%zu\t%d", i, WEXITSTATUS(fork_server.jobs[i].status));
+        else
+            fprintf(stderr, "\t%zu\tsignal %d", i, WTERMSIG(fork_server.jobs[i].status));
+
+        fprintf(stderr,
+                "\t%.6fs\t%zu\t%.6fs\t%s\n",
+                fork_server.results[i].latency,
+                fork_server.results[i].instructions,
+                fork_server.results[i].seconds,
+                fork_server.jobs[i].input);
+    }
+
+    fprintf(stderr,
+            "\tJobs: %zu (%zu failed)\n"
+            "\tSnapshot taken after: %zu instructions, %.6fs\n"
+            "\tMean startup latency: %.6fs (%.6fs without the fork server, running up to the snapshot)\n"
+            "\tTime: %.6fs\n",
+            fork_server.length,
+            fork_server.failed,
+            fork_server.instructions,
+            fork_server.seconds,
+            started ? latency / started : 0,
+            fork_server.seconds,
+            fork_server.total);
+}
+
+void fork_server_end(void) { // Cleanup
+    for(uint64_t i = 0; i < fork_server.length; i++) {
+        free(fork_server.jobs[i].input);
+        free(fork_server.jobs[i].output);
+        free(fork_server.jobs[i].disk);
+    }
+
+    free(fork_server.jobs);
+
+    if(fork_server.results != NULL)
+        munmap(fork_server.results, fork_server.length * sizeof(struct fork_server_result));
+
+    fork_server.jobs = NULL;
+    fork_server.results = NULL;
+    fork_server.length = fork_server.size = 0;
+}
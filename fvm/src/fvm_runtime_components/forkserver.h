@@ -0,0 +1,47 @@
+#ifndef FVMR_FORKSERVER_H
+
+#define FVMR_FORKSERVER_H
+
+#include <sys/types.h>
+#include <time.h>
+#include "global.h"
+#include "pinned.h"
+
+// Job files have one job per line, as "<input> [<output> [<disk>]]", where input and output are files for its console
+// (with its output discarded when left out), and disk is used instead of the Disk file. Blank lines and lines starting
+// with '#' are skipped.
+
+struct fork_server_job { // One job from the job file
+    char *input, // Paths from the job file (output and disk are NULL when left out)
+         *output,
+         *disk;
+    pid_t pid; // Process running it (0 if it hasn't been started yet)
+    int status; // Its wait status once it has exited
+    struct timespec forked; // When it was started
+};
+
+struct fork_server_result { // What a job reports back, in memory shared with the fork server
+    double latency, // Seconds from fork() to running the job's first instruction
+           seconds; // Wall-clock time spent executing
+    uint64_t instructions; // Number executed after the snapshot
+};
+
+extern struct fvmr_fork_server { // Runs the ROM up to a snapshot once, then forks a copy of it for each job, so that the copies share Main Memory and the Callstack copy-on-write
+    struct fork_server_job *jobs;
+    uint64_t length, // Number of jobs
+             size, // Number allocated for
+             instructions, // Number executed before the snapshot
+             failed; // Number of jobs that didn't exit with FVMR_EXIT_SUCCESS
+    struct fork_server_result *results; // One per job, mapped shared
+    long disk_offset; // Position in the disk at the snapshot, which each job starts from on its own file descriptor
+    double seconds, // Wall-clock time spent getting to the snapshot, which each job would otherwise spend itself
+           total; // Wall-clock time for all the jobs
+} fork_server;
+
+extern _Bool fork_server_init(const char *jobs); // Read the job file, returns 1 on failure
+extern _Bool fork_server_snapshot(uint64_t steps, uint64_t marker); // Run the ROM from CEA until steps instructions have run or CEA reaches marker. Returns 1 if it stopped for any other reason first, setting fvmr_exit_code as it would have been
+extern _Bool fork_server_run(uint64_t workers, void (*run)(void)); // Fork a copy of the snapshot for each job, with at most workers (or one per online CPU if 0) at once, and have it carry on with run. Returns 1 if the jobs could not be started
+extern void fork_server_report(void); // Print each job's exit code and startup latency, and the totals
+extern void fork_server_end(void); // Cleanup
+
+#endif
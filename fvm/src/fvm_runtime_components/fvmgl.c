@@ -8,7 +8,18 @@
 
 // This file handles all primary GLFW and GL operations. As such, fvmkbd cannot be used until fvmgl has been initialised.
 
+// Window events are polled for by the engines only every so many instructions (or on a timer), through service_run(),
+// rather than on every instruction, since glfwPollEvents() is far more expensive than most of the instructions it would
+// sit between. The guest never sees them late though: the operations that read anything events change (the keypress
+// queue, the window closing or being resized) poll first, and a frame being swapped polls as well.
+
+#ifndef FVMR_HEADLESS // Stood in for by headless.c
+
 #include "fvmgl.h"
+#include "fvmkbd.h"
+#include "service.h"
+
+#include <signal.h>
 
 const char *FVMGL_GL_ERROR_DESCRIPTIONS[] = {
     [GL_INVALID_ENUM] = "Invalid enum.",
@@ -20,17 +31,15 @@ const char *FVMGL_GL_ERROR_DESCRIPTIONS[] = {
 };
 
 
-struct fvmgl_screen fvmgl_screen_object = {
-    .window = NULL,
-    .monitor = NULL,
-    .window_width = FVMGL_DEFAULT_WIDTH,
-    .window_height = FVMGL_DEFAULT_HEIGHT,
-    .working_width = FVMGL_DEFAULT_WIDTH,
-    .working_height = FVMGL_DEFAULT_HEIGHT,
-    .working_depth = FVMGL_DEFAULT_DEPTH,
-    .title = FVMGL_DEFAULT_TITLE,
-    .perspective = 0,
-    .errors = 0
+FVMR_VM_STATE struct fvmgl_screen fvmgl_screen_object = FVMGL_SCREEN_DEFAULTS;
+
+struct fvmgl_polling fvmgl_polling = {
+    .every = UINT64_MAX,
+    .interval = 0,
+    .next = UINT64_MAX,
+    .keyboard_next = 0,
+    .requested = 0,
+    .timed = 0
 };
 
 void fvmgl_error(_Bool glError, int error, const char *description) { // Error reporting function used by both the glfw error callback and the manual gl error checks
@@ -212,8 +221,30 @@ _Bool fvmgl_init(void) { // Setup function
     return fvmgl_catch_errors();
 }
 
+_Bool fvmgl_require(void) { // Initialise fvmgl and fvmkbd on first use
+    if(!fvmgl_screen_object.deferred)
+        return 0;
+
+    fvmgl_screen_object.deferred = 0; // Only tried once, leaving the VM without a screen if it fails
+
+    if(fvmgl_init()) {
+        fprintf(stderr, "fvmr -> Graphics API -> Failed to initialise.\n");
+
+        return 1;
+    }
+
+    if(fvmkbd_init(fvmgl_screen_object.window)) {
+        fprintf(stderr, "fvmr -> Keyboard API -> Failed to initialise.\n");
+
+        return 1;
+    }
+
+    return 0;
+}
+
 _Bool fvmgl_update(uint64_t *data) { // Handle calls from the program running on the VM
     int width, height;
+    double now;
     char *title;
 
     switch(data[0]) { // Depending on the instruction...
@@ -293,7 +324,10 @@ _Bool fvmgl_update(uint64_t *data) { // Handle calls from the program running on
         case FVMGL_SWAP_BUFFERS:
             glfwSwapBuffers(fvmgl_screen_object.window);
 
-            return fvmgl_catch_errors();
+            if(fvmgl_catch_errors())
+                return 1;
+
+            return fvmgl_poll(); // Once a frame, so that a guest drawing frames never leaves the window waiting for longer than one takes
         case FVMGL_SET_PROJECTION:
             fvmgl_screen_object.perspective = data[1];
 
@@ -310,14 +344,48 @@ _Bool fvmgl_update(uint64_t *data) { // Handle calls from the program running on
 
             return fvmgl_catch_errors();
         case FVMGL_GET_WINDOW_SHOULD_CLOSE:
+            if(fvmgl_poll())
+                return 1;
+
             data[1] = glfwWindowShouldClose(fvmgl_screen_object.window);
 
             return fvmgl_catch_errors();
         case FVMGL_GET_WINDOW_DIMENSIONS:
+            if(fvmgl_poll()) // For any resize still waiting to be handled
+                return 1;
+
             data[1] = fvmgl_screen_object.window_width,
             data[2] = fvmgl_screen_object.window_height;
 
             return 0;
+        case FVMGL_WAIT_EVENTS:
+            if(fvmkbd.keypress_queue_length) // Something is already waiting to be read
+                return fvmgl_poll();
+
+            if(data[1])
+                glfwWaitEventsTimeout(data[1] / 1e3);
+            else
+                glfwWaitEvents();
+
+            if(fvmgl_screen_object.errors || fvmkbd.errors) // Raised by callbacks while waiting, as by fvmgl_poll()
+                return 1;
+
+            return fvmgl_catch_errors();
+        case FVMGL_WAIT_FRAME:
+            now = glfwGetTime();
+
+            fvmgl_screen_object.frame_deadline += data[1] / 1e6;
+
+            if(fvmgl_screen_object.frame_deadline < now) // Behind (or the first frame), so counted again from now rather than rushing to catch up
+                fvmgl_screen_object.frame_deadline = now;
+
+            while((now = glfwGetTime()) < fvmgl_screen_object.frame_deadline && !fvmgl_screen_object.errors) // Events are handled while waiting, but don't cut the frame short
+                glfwWaitEventsTimeout(fvmgl_screen_object.frame_deadline - now);
+
+            if(fvmkbd.errors)
+                return 1;
+
+            return fvmgl_catch_errors();
         default:
             fprintf(stderr,
                     "fvmr -> Graphics API -> Got invalid instruction '%zu'!\n",
@@ -327,13 +395,97 @@ _Bool fvmgl_update(uint64_t *data) { // Handle calls from the program running on
     }
 }
 
-_Bool fvmgl_tick(void) { // Update the graphics API each execution cycle
+static void fvmgl_poll_signal(int signal) { // Interval timer handler, which has a poll done at the engine's next chance
+    (void)signal;
+
+    atomic_store(&fvmgl_polling.requested, 1);
+
+    service_interrupt();
+}
+
+void fvmgl_poll_init(uint64_t every, uint64_t interval) { // Start polling for window events for a run
+    struct sigaction action = {.sa_handler = fvmgl_poll_signal, .sa_flags = SA_RESTART};
+    struct sigevent event = {.sigev_notify = SIGEV_SIGNAL, .sigev_signo = SIGRTMIN};
+    struct itimerspec timer = {
+        .it_interval = {.tv_sec = interval / 1000, .tv_nsec = interval % 1000 * 1000000},
+        .it_value = {.tv_sec = interval / 1000, .tv_nsec = interval % 1000 * 1000000}
+    };
+
+    fvmgl_polling.every = interval ? UINT64_MAX : every;
+    fvmgl_polling.interval = interval;
+    fvmgl_polling.next = fvmgl_polling.every;
+
+    atomic_store(&fvmgl_polling.requested, 0);
+
+    if(interval) {
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGRTMIN, &action, NULL);
+
+        if(timer_create(CLOCK_MONOTONIC, &event, &fvmgl_polling.timer)) {
+            perror("fvmr -> Could not start polling for window events"); // Left to the guest's own graphics and keyboard operations
+        } else {
+            fvmgl_polling.timed = 1;
+
+            timer_settime(fvmgl_polling.timer, 0, &timer, NULL);
+        }
+    }
+
+    service_schedule();
+}
+
+_Bool fvmgl_poll(void) { // Poll for window events now
+    if(fvmgl_screen_object.window == NULL) // Nothing to poll for a VM that was made without a screen
+        return fvmgl_screen_object.errors;
+
     glfwPollEvents();
 
+    if(fvmgl_screen_object.errors || fvmkbd.errors) { // Raised by callbacks, which can't stop the VM themselves, so it's stopped at the engine's next chance
+        fvmgl_polling.next = 0;
+
+        service_interrupt();
+    }
+
     return fvmgl_screen_object.errors;
 }
 
+_Bool fvmgl_poll_keyboard(void) { // Poll for window events at one of the guest's keyboard operations, if it's due
+    struct timespec now;
+    uint64_t milliseconds;
+
+    if(fvmgl_polling.every != UINT64_MAX || fvmgl_polling.interval) { // Otherwise these are the only polls, and a keypress has to be seen when the guest looks for it
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+
+        if((milliseconds = now.tv_sec * 1000 + now.tv_nsec / 1000000) < fvmgl_polling.keyboard_next)
+            return fvmgl_screen_object.errors;
+
+        fvmgl_polling.keyboard_next = milliseconds + FVMGL_POLL_KEYBOARD_GAP;
+    }
+
+    return fvmgl_poll();
+}
+
+_Bool fvmgl_tick(uint64_t executed) { // Poll for window events if one is due
+    if(!atomic_exchange(&fvmgl_polling.requested, 0) && executed < fvmgl_polling.next)
+        return fvmgl_screen_object.errors;
+
+    fvmgl_polling.next = fvmgl_polling.every == UINT64_MAX ? UINT64_MAX : executed + fvmgl_polling.every;
+
+    return fvmgl_poll();
+}
+
+void fvmgl_poll_end(void) { // Stop the interval timer
+    if(fvmgl_polling.timed)
+        timer_delete(fvmgl_polling.timer);
+
+    fvmgl_polling.timed = 0;
+    fvmgl_polling.next = UINT64_MAX;
+}
+
 void fvmgl_end(void) { // Cleanup
-    glfwDestroyWindow(fvmgl_screen_object.window);
+    if(fvmgl_screen_object.window != NULL) // Never made if fvmgl was deferred and the screen and keyboard never used
+        glfwDestroyWindow(fvmgl_screen_object.window);
+
     glfwTerminate();
 }
+
+#endif
@@ -2,9 +2,17 @@
 
 #define FVMR_FVMGL_H
 
+#ifdef FVMR_HEADLESS // Built without GLFW or GL, with the screen buffer and keyboard stood in for by headless.c instead of fvmgl.c
+typedef struct GLFWwindow GLFWwindow;
+typedef struct GLFWmonitor GLFWmonitor;
+#else
 #include <GLFW/glfw3.h>
+#endif
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
+#include "global.h"
 
 #define FVMGL_DEFAULT_WIDTH 1280
 #define FVMGL_DEFAULT_HEIGHT 720
@@ -12,6 +20,24 @@
 
 #define FVMGL_DEFAULT_TITLE "FVMR Screen"
 
+#define FVMGL_POLL_EVERY 1000000 // Instructions between polls for window events by default, which keeps the window responsive to within a few milliseconds on every engine
+#define FVMGL_POLL_KEYBOARD_GAP 1 // Milliseconds that have to pass between polls at the guest's keyboard operations, unless they're the only polls (--poll=io), so that a guest waiting on the keypress queue in a loop isn't held up by one every time round it
+
+#define FVMGL_SCREEN_DEFAULTS { /* A screen that hasn't been initialised yet */ \
+    .window = NULL, \
+    .monitor = NULL, \
+    .window_width = FVMGL_DEFAULT_WIDTH, \
+    .window_height = FVMGL_DEFAULT_HEIGHT, \
+    .working_width = FVMGL_DEFAULT_WIDTH, \
+    .working_height = FVMGL_DEFAULT_HEIGHT, \
+    .working_depth = FVMGL_DEFAULT_DEPTH, \
+    .title = FVMGL_DEFAULT_TITLE, \
+    .perspective = 0, \
+    .frame_deadline = 0, \
+    .deferred = 0, \
+    .errors = 0 \
+}
+
 extern const char *FVMGL_GL_ERROR_DESCRIPTIONS[]; // Descriptions of errors to print out in place of their codes if they occur
 
 enum fvmgl_instruction {                // Instructions that can be executed by the program running in the VM
@@ -26,10 +52,14 @@ enum fvmgl_instruction {                // Instructions that can be executed by
     FVMGL_SET_PROJECTION = 8,           // Set perspective or orthographic projection (0 = orthographic, 1 = perspective)
     FVMGL_CLEAR_BUFFERS = 9,            // Clear the depth and colour buffers
     FVMGL_GET_WINDOW_SHOULD_CLOSE = 10, // Place 1 in the cell after the instruction, if the window should closed
-    FVMGL_GET_WINDOW_DIMENSIONS = 11    // Set the two cells after the instruction to the width and the height of the window
+    FVMGL_GET_WINDOW_DIMENSIONS = 11,   // Set the two cells after the instruction to the width and the height of the window
+    FVMGL_WAIT_EVENTS = 12,             // Sleep until a keypress or window event arrives, or the number of milliseconds in the cell after the instruction pass (0 to wait without a timeout). Returns at once if there are keypresses queued already
+    FVMGL_WAIT_FRAME = 13               // Sleep (handling events) until the number of microseconds in the cell after the instruction have passed since the last frame was due, for pacing frames without vsync
 };
 
-extern struct fvmgl_screen { // An object to keep track of the screen and its parameters
+#define FVMGL_NO_INSTRUCTIONS 14 // Number of instructions in enum fvmgl_instruction
+
+extern FVMR_VM_STATE struct fvmgl_screen { // An object to keep track of the screen and its parameters
     GLFWwindow *window;
     GLFWmonitor *monitor;
     uint64_t window_width,
@@ -38,17 +68,36 @@ extern struct fvmgl_screen { // An object to keep track of the screen and its pa
              working_height,
              working_depth;
     char *title;
+    double frame_deadline; // When the last frame paced by FVMGL_WAIT_FRAME was due, in seconds on the screen's clock
     _Bool perspective,
+          deferred, // If fvmgl and fvmkbd are to be initialised the first time the screen buffer or keyboard is used, rather than the VM being without them
           errors;
 } fvmgl_screen_object;
 
+extern struct fvmgl_polling { // When window events are polled for, besides at the guest's own graphics and keyboard operations
+    uint64_t every, // Instructions between polls (UINT64_MAX for none)
+             interval, // Milliseconds between polls, instead of every so many instructions (0 for none)
+             next; // Instructions into the run when the next poll is due (UINT64_MAX if none is)
+    uint64_t keyboard_next; // When the guest's keyboard operations next poll, in milliseconds on CLOCK_MONOTONIC_COARSE (which is read far more cheaply than the screen's clock, at the cost of only ticking every few milliseconds)
+    _Atomic _Bool requested; // If the interval timer has asked for one
+    _Bool timed; // If the interval timer was made
+    timer_t timer;
+} fvmgl_polling;
+
+#ifndef FVMR_HEADLESS
 extern void fvmgl_error(_Bool glError, int error, const char *description); // Error reporting function used by both the glfw error callback and the manual gl error checks
 extern void fvmgl_error_cb(int error, const char *description); // Error callback function for glfw
 extern _Bool fvmgl_catch_errors(void); // Error checker to see if glfw or gl encountered errors
 extern void fvmgl_framebuffer_resized_cb(GLFWwindow *window, int width, int height); // Callback function for when the window is resized. Makes a viewport a box that fits within the dimensions of the window, accounting for difference in aspect ratio
+#endif
 extern _Bool fvmgl_init(void); // Setup function
+extern _Bool fvmgl_require(void); // Initialise fvmgl and fvmkbd if they were deferred until now, on the guest's first use of the screen buffer or keyboard, returns 1 on failure
 extern _Bool fvmgl_update(uint64_t *data); // Handle calls from the program running on the VM
-extern _Bool fvmgl_tick(void); // Update the graphics API each execution cycle
+extern void fvmgl_poll_init(uint64_t every, uint64_t interval); // Start polling for window events every so many instructions, or every interval milliseconds if interval isn't 0, for a run (UINT64_MAX and 0 to only poll at the guest's graphics and keyboard operations)
+extern _Bool fvmgl_poll(void); // Poll for window events now, returns 1 if there were errors
+extern _Bool fvmgl_poll_keyboard(void); // Poll for window events at one of the guest's keyboard operations, if FVMGL_POLL_KEYBOARD_GAP has passed since the last one did or there are no other polls, returns 1 if there were errors
+extern _Bool fvmgl_tick(uint64_t executed); // Poll for window events if one is due by the time executed instructions have run (called through service_run()), returns 1 if there were errors
+extern void fvmgl_poll_end(void); // Stop the interval timer
 extern void fvmgl_end(void); // Cleanup
 
 #endif
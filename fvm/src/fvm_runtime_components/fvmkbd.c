@@ -7,8 +7,9 @@
  */
 
 #include "fvmkbd.h"
+#include "fvmgl.h"
 
-struct fvmkbd_data fvmkbd; // Define fvmkbd for API runtime data
+FVMR_VM_STATE struct fvmkbd_data fvmkbd; // Define fvmkbd for API runtime data
 
 struct fvmkbd_keypress fvmkbd_dequeue_keypress(void) { // Remove the element at the start of the keypress queue and return it
     if(!fvmkbd.keypress_queue_length) // If the queue is empty return keypress with all-zero values
@@ -59,7 +60,15 @@ void fvmkbd_keypress_cb(GLFWwindow *window, int key, int scancode, int action, i
 }
 
 _Bool fvmkbd_init(GLFWwindow *window) { // Initialise fvmkbd (must be called only after fvmgl is initialised)
+#ifndef FVMR_HEADLESS // Headless keypresses come from the keyboard file instead (see headless.c)
     glfwSetKeyCallback(window, fvmkbd_keypress_cb); // Set callback for keypresses (errors will be handled by fvmgl)
+#endif
+
+    if(fvmkbd.keypress_queue != NULL) { // Keypresses were put back from a checkpoint before the keyboard was first used, so the queue is kept
+        fvmkbd.window = window;
+
+        return 0;
+    }
 
     fvmkbd = (struct fvmkbd_data) { // Initialise fvmkbd runtime data
         .window = window,
@@ -73,10 +82,14 @@ _Bool fvmkbd_init(GLFWwindow *window) { // Initialise fvmkbd (must be called onl
 }
 
 void fvmkbd_get_keypress_queue_length(void) {
+    fvmgl_poll_keyboard(); // So that keypresses are seen soon after the guest looks for them, without polling every time it does (any error stops the VM at the engine's next chance)
+
     fvm_registers[MDR] = fvmkbd.keypress_queue_length;
 }
 
 void fvmkbd_get_next_keypress_as_key(void) {
+    fvmgl_poll_keyboard();
+
     // Dequeue the keypress and set MDR to it in the requested format:
 
     struct fvmkbd_keypress keypress = fvmkbd_dequeue_keypress();
@@ -87,10 +100,14 @@ void fvmkbd_get_next_keypress_as_key(void) {
 }
 
 void fvmkbd_get_scancode_for_key(void) {
+#ifndef FVMR_HEADLESS // Headless, keys are their own scancodes, since there's no platform to translate them for
     fvm_registers[MDR] = glfwGetKeyScancode(fvm_registers[MDR]);
+#endif
 }
 
 void fvmkbd_get_next_keypress_as_scancode(void) {
+    fvmgl_poll_keyboard();
+
     // Dequeue the keypress and set MDR to it in the requested format:
 
     struct fvmkbd_keypress keypress = fvmkbd_dequeue_keypress();
@@ -2,10 +2,10 @@
 
 #define FVMKBD_H
 
-#include <GLFW/glfw3.h>
 #include "global.h"
+#include "fvmgl.h"
 
-extern struct fvmkbd_data { // Runtime data used by the Keyboard API
+extern FVMR_VM_STATE struct fvmkbd_data { // Runtime data used by the Keyboard API
     GLFWwindow *window;
     size_t keypress_queue_size, // Slots allocated in memory for the keypress queue
            keypress_queue_length; // Number of slots actually used in queue
@@ -18,13 +18,14 @@ extern struct fvmkbd_data { // Runtime data used by the Keyboard API
     _Bool errors; // If errors have occurred
 } fvmkbd;
 
+extern void fvmkbd_enqueue_keypress(struct fvmkbd_keypress keypress); // Add a keypress to the end of fvmkbd.keypress_queue
 extern void fvmkbd_keypress_cb(GLFWwindow *, int, int, int, int); // Keypress callback that adds the enqueues the keypresses to fvmkbd.keypress_queue
 extern _Bool fvmkbd_init(GLFWwindow *); // fvmkbd initialisation
 extern void fvmkbd_get_keypress_queue_length(void); // Set mdr = length of the keypress queue
 extern void fvmkbd_get_next_keypress_as_key(void); // Dequeue keypress from keypress queue and place it in mdr in the format [2 bytes 0][1 byte action][1 byte modifiers][4 bytes GLFW key]
 extern void fvmkbd_get_scancode_for_key(void); // Translate GLFW key in MDR to its platform-specific scancode and place the value in the MDR
 extern void fvmkbd_get_next_keypress_as_scancode(void); // Dequeue keypress from keypress queue and place it in mdr in the format [2 bytes 0][1 byte action][1 byte modifiers][4 bytes platform-specific scancode]
-extern _Bool fvmkbd_tick(void); // Updates events for fvmkbd every CPU cycle, and returns 1 if there were errors and the VM should be subsequently shut down
+extern _Bool fvmkbd_tick(void); // Returns 1 if there were errors and the VM should be subsequently shut down (checked after each poll for window events, which is when they're raised)
 extern void fvmkbd_end(void); // Cleanup
 
 #endif
@@ -7,15 +7,25 @@
  */
 
 #include "global.h"
+#include "paged.h"
 
-enum fvmr_exit_code_value fvmr_exit_code;
+#include <ctype.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
 
-void *alloc_buff;
-FILE *disk;
+FVMR_VM_STATE enum fvmr_exit_code_value fvmr_exit_code;
 
-struct fvm_file files[NO_FILES];
+FVMR_VM_STATE void *alloc_buff;
+FVMR_VM_STATE FILE *disk;
+FVMR_VM_STATE FILE *console_input,
+                   *console_output;
 
-uint64_t fvm_registers[NO_REGISTERS];
+FVMR_VM_STATE struct fvm_file files[NO_FILES];
+
+FVMR_VM_STATE uint64_t fvm_registers[NO_REGISTERS];
+
+FVMR_VM_STATE struct fvmr_stats fvmr_stats;
 
 const char *REGISTER_NAMES[NO_REGISTERS] = {
 	"MCH (Memory Channel)           ",
@@ -35,6 +45,108 @@ const char *REGISTER_NAMES[NO_REGISTERS] = {
     "GP7 (General Purpose 7)        ",
 };
 
+double elapsed(const struct timespec *start) { // Seconds since start
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+uint64_t line_fields(char *line, char **fields, uint64_t max) { // Split line on whitespace into at most max fields
+    uint64_t no_fields;
+
+    for(no_fields = 0; no_fields < max; no_fields++) {
+        while(isspace((unsigned char)*line))
+            *line++ = '\0';
+
+        if(!*line)
+            break;
+
+        fields[no_fields] = line;
+
+        while(*line && !isspace((unsigned char)*line))
+            line++;
+    }
+
+    return no_fields && *fields[0] == '#' ? 0 : no_fields;
+}
+
+_Bool file_reserve(struct fvm_file *file, uint64_t address) { // Make sure address is within file's allocation
+    uint64_t size = file->size > UINT64_MAX / 2 ? UINT64_MAX : file->size * 2; // Doubling, so that walking upwards through memory copies each cell a constant number of times
+
+    if(address < file->size)
+        return 0;
+
+    if(file->mapped || address >= SIZE_MAX / sizeof(uint64_t)) { // A mapping can't be grown in place
+        errno = ENOMEM;
+
+        return 1;
+    }
+
+    if(size <= address)
+        size = address + 1;
+
+    if(size < ALLOC_SIZE)
+        size = ALLOC_SIZE;
+
+    if(size > SIZE_MAX / sizeof(uint64_t))
+        size = SIZE_MAX / sizeof(uint64_t);
+
+    if((alloc_buff = realloc(file->self, size * sizeof(uint64_t))) == NULL)
+        return 1;
+
+    file->self = (uint64_t *)alloc_buff;
+
+    memset(&file->self[file->size], 0, (size - file->size) * sizeof(uint64_t)); // Cells that were never written to read as 0
+
+    file->size = size;
+
+    return 0;
+}
+
+void file_free(struct fvm_file *file) { // Free file's cells
+    if(file->mapped)
+        munmap(file->self, file->mapped * sizeof(uint64_t));
+    else
+        free(file->self);
+
+    file->self = NULL;
+}
+
+static void traceback_paged(void) { // Display the cells written to past the end of Main Memory that aren't 0
+	struct paged_chunk **chunks;
+	uint64_t length = paged_sorted(&paged, &chunks),
+			 address;
+
+	fprintf(stderr,
+			"\t---Paged Memory---\n"
+			"\tAddress\tValue\n");
+
+	for(uint64_t i = 0; i < length; i++) {
+		for(uint64_t j = 0; j < PAGED_CHUNK_CELLS; j++) {
+			if(!(chunks[i]->touched[j >> PAGED_PAGE_SHIFT >> 6] & (uint64_t)1 << (j >> PAGED_PAGE_SHIFT & 63))) { // Skip pages that were never written to
+				j |= ((uint64_t)1 << PAGED_PAGE_SHIFT) - 1;
+
+				continue;
+			}
+
+			address = chunks[i]->index << PAGED_CHUNK_SHIFT | j;
+
+			if(address < files[MEM].length || !chunks[i]->cells[j]) // Either in Main Memory now, or not worth showing
+				continue;
+
+			fprintf(stderr,
+					"\t%zu\t%zu%s\n",
+					address,
+					chunks[i]->cells[j],
+					fvm_registers[MCH] == MEM && address == fvm_registers[MAR] ? "\t<- MAR" : "");
+		}
+	}
+
+	free(chunks);
+}
+
 void traceback(void) { // Traceback (error report)
 	fprintf(stderr,
 			"fvmr -> Traceback:\n"
@@ -73,4 +185,18 @@ void traceback(void) { // Traceback (error report)
 				i == fvm_registers[CEA] ? "\t<- CEA" : "",
 				fvm_registers[MCH] == MEM && i == fvm_registers[MAR] ? "\t<- MAR" : "");
 	}
+
+	if(paged.length) // Display the cells of paged memory that aren't 0
+		traceback_paged();
+}
+
+void stats_report(void) { // Print fvmr_stats
+    fprintf(stderr,
+            "fvmr -> Stats:\n"
+            "\tInstructions executed: %zu\n"
+            "\tTime: %.6fs\n"
+            "\tMIPS: %.2f\n",
+            fvmr_stats.instructions,
+            fvmr_stats.seconds,
+            fvmr_stats.seconds > 0 ? (double)fvmr_stats.instructions / fvmr_stats.seconds / 1e6 : 0);
 }
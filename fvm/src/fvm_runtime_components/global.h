@@ -5,8 +5,13 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <time.h>
 
-#define FVM_ROM "hardware/rom" // The ROM file
+#define FVMR_VERSION "0.4-alpha" // Version of the runtime
+
+#define FVM_ROM "hardware/rom" // The ROM file, unless another is given with --rom=
+#define FVM_ROM_RESERVE ((uint64_t)1 << 32) // Cells of address space reserved for Main Memory when the ROM is mapped into it, so that it can grow in place
+#define FVM_HUGE_PAGE ((uint64_t)1 << 21) // Bytes in a huge page (2MiB), which --huge-pages=explicit maps Main Memory in multiples of
 #define FVM_DISK "hardware/disk" // The Disk file
 #define NO_FILES 4 // Number of files/memory channels
 #define NO_REGISTERS 15 // Number of registers
@@ -14,29 +19,40 @@
 
 #define ALLOC_SIZE 50 // Size to reallocate/allocate memory
 
-extern enum fvmr_exit_code_value {
+#define FVMR_VM_STATE _Thread_local // Marks state that belongs to the VM running on this thread, which is swapped in and out of a struct fvm_vm by the library (see vm.h)
+
+extern FVMR_VM_STATE enum fvmr_exit_code_value {
     FVMR_EXIT_SUCCESS = 0,
     FVMR_EXIT_FAILURE_INITIAL_ALLOCATION = 1,
     FVMR_EXIT_FAILURE_INITIAL_FILE_ACCESS = 2,
     FVMR_EXIT_FAILURE_EXECUTION = 3,
     FVMR_EXIT_FAILURE_GRAPHICS_LIB = 4,
-    FVMR_EXIT_FAILURE_KEYBOARD_LIB = 5
+    FVMR_EXIT_FAILURE_KEYBOARD_LIB = 5,
+    FVMR_EXIT_FAILURE_ARGUMENTS = 6,
+    FVMR_EXIT_FAILURE_VERIFICATION = 7,
+    FVMR_EXIT_FAILURE_BUDGET = 8
 } fvmr_exit_code;
 
-extern void *alloc_buff; // Buffer for memory allocation
-extern FILE *disk; // File pointer to disk file at boot
+extern FVMR_VM_STATE void *alloc_buff; // Buffer for memory allocation
+extern FVMR_VM_STATE FILE *disk; // File pointer to disk file at boot
+extern FVMR_VM_STATE FILE *console_input, // What MAR 0 on INP reads from (stdin for fvmr, NULL for none, which reads EOF)
+                          *console_output; // What MAR 0 on OUT writes to (stdout for fvmr, NULL for none, which discards it)
 
 enum fvm_file_no { // Files' designated numbers
 	MEM = 0,
 	INP = 1,
 	OUT = 2,
-	CST = 3
+	CST = 3,
+	ALC = 4, // Not a file, but the heap allocator (see heap.h)
+	BLK = 5, // Nor this, but bulk operations over Main Memory (see bulk.h)
+	BYT = 6 // Main Memory again, but a byte at a time (see memory_load_byte())
 };
 
-extern struct fvm_file {
+extern FVMR_VM_STATE struct fvm_file {
 	uint64_t *self,
-			 size,
-			 length;
+			 size, // Cells allocated, all of them past length being 0
+			 length, // Cells in use (for MEM, up to the highest address written to)
+			 mapped; // Cells mapped with mmap() rather than allocated on the heap (0 if they weren't), which it can't grow past
 } files[NO_FILES]; // files/memory channels (only MEM and CST are actually stored like this)
 
 enum fvm_register { // Registers' designated numbers
@@ -57,10 +73,20 @@ enum fvm_register { // Registers' designated numbers
     GP7 = 14
 };
 
-extern uint64_t fvm_registers[NO_REGISTERS]; // All the registers
+extern FVMR_VM_STATE uint64_t fvm_registers[NO_REGISTERS]; // All the registers
 
 extern const char *REGISTER_NAMES[NO_REGISTERS]; // Register names for traceback
 
+extern FVMR_VM_STATE struct fvmr_stats { // Execution statistics, printed on exit with --stats
+    uint64_t instructions; // Number of instructions executed (not counting the final fi)
+    double seconds; // Wall-clock time spent executing
+} fvmr_stats;
+
+extern _Bool file_reserve(struct fvm_file *file, uint64_t address); // Make sure address is within file's allocation, growing it geometrically with the new cells zeroed, returns 1 on failure (with errno set)
+extern void file_free(struct fvm_file *file); // Free file's cells, however they were allocated
+extern double elapsed(const struct timespec *start); // Seconds since start, on CLOCK_MONOTONIC
+extern uint64_t line_fields(char *line, char **fields, uint64_t max); // Split line on whitespace in place into at most max fields, returns how many it found (0 for a blank line or a comment, which starts with '#')
 extern void traceback(void); // Traceback (error report)
+extern void stats_report(void); // Print fvmr_stats
 
 #endif
@@ -0,0 +1,435 @@
+/* Fox Virtual Machine: Decoded Instruction Handler Bodies
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// Included into the body of each engine's run function (see handlers.h), so there's no include guard. The behaviour of
+// each handler must stay identical to its counterpart in instructions.c.
+
+    HANDLER(DECODED_PLACE): // pl <value> <register>
+        fvm_registers[HANDLER_SLOT.reg[0]] = HANDLER_SLOT.operand;
+
+        cea += 2;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_PLACE_ACC): // pl <value> acc
+        acc = HANDLER_SLOT.operand;
+
+        cea += 2;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_PLACE_DAT): // pl <value> dat
+        dat = HANDLER_SLOT.operand;
+
+        cea += 2;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_PLACE_CEA): // pl <value> cea
+        cea = HANDLER_SLOT.operand + 2;
+
+        HANDLER_EXIT(1);
+    HANDLER(DECODED_MOVE): // mv <register> <register>
+        fvm_registers[HANDLER_SLOT.reg[1]] = fvm_registers[HANDLER_SLOT.reg[0]];
+
+        cea += 2;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_MOVE_TO_ACC): // mv <register> acc
+        acc = fvm_registers[HANDLER_SLOT.reg[0]];
+
+        cea += 2;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_MOVE_FROM_ACC): // mv acc <register>
+        fvm_registers[HANDLER_SLOT.reg[1]] = acc;
+
+        cea += 2;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_MOVE_ANY): // mv <register> <register>, where either can be held in a local
+        value = HANDLER_READ(HANDLER_SLOT.reg[0]);
+
+        if(HANDLER_SLOT.reg[1] == CEA) { // Moving into CEA is a jump to somewhere the decoder couldn't see
+            cea = value + 2;
+
+            HANDLER_EXIT_DYNAMIC();
+        }
+
+        HANDLER_WRITE(HANDLER_SLOT.reg[1], value);
+
+        cea += 2;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_STORE): // st
+generic_store:
+        if(decoder.quicken)
+            decoder_quicken(&HANDLER_SLOT, DECODED_STORE, decoder_store_specialisation());
+
+        HANDLER_STORE();
+        HANDLER_NEXT();
+    HANDLER(DECODED_LOAD): // ld
+generic_load:
+        if(decoder.quicken)
+            decoder_quicken(&HANDLER_SLOT, DECODED_LOAD, decoder_load_specialisation());
+
+        HANDLER_LOAD();
+        HANDLER_NEXT();
+    HANDLER(DECODED_JUMP): // jm <address>
+        cea = HANDLER_SLOT.operand - 1;
+
+        HANDLER_EXIT(1);
+    HANDLER(DECODED_JUMP_IF_SET): // js <address>
+        if(acc) {
+            cea = HANDLER_SLOT.operand - 1;
+
+            HANDLER_EXIT(1);
+        }
+
+        cea++;
+
+        HANDLER_EXIT(0);
+    HANDLER(DECODED_JUMP_IF_CLEAR): // jc <address>
+        if(!acc) {
+            cea = HANDLER_SLOT.operand - 1;
+
+            HANDLER_EXIT(1);
+        }
+
+        cea++;
+
+        HANDLER_EXIT(0);
+    HANDLER(DECODED_ACCUMULATOR_ADD): // a+
+        acc += dat;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_ACCUMULATOR_SUB): // a-
+        acc -= dat;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_ACCUMULATOR_NOT): // a!
+        acc = ~acc;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_ACCUMULATOR_INCREMENT): // ai
+        acc++;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_ACCUMULATOR_DECREMENT): // ad
+        acc--;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_ACCUMULATOR_MUL): // a*
+        acc *= dat;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_ACCUMULATOR_DIV): // a/
+        acc /= dat;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_ACCUMULATOR_AND): // a&
+        acc &= dat;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_ACCUMULATOR_OR): // a|
+        acc |= dat;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_ACCUMULATOR_XOR): // a^
+        acc ^= dat;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_ACCUMULATOR_LSH): // al
+        acc <<= dat;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_ACCUMULATOR_RSH): // ar
+        acc >>= dat;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_ACCUMULATOR_GT): // gt
+        acc = acc > dat;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_ACCUMULATOR_LT): // lt
+        acc = acc < dat;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_ACCUMULATOR_GE): // ge
+        acc = acc >= dat;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_ACCUMULATOR_LE): // le
+        acc = acc <= dat;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_ACCUMULATOR_EQ): // eq
+        acc = acc == dat;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_ACCUMULATOR_NE): // ne
+        acc = acc != dat;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_CALL): // cl <address>
+        if(quota_push()) // Try to grow the callstack if it needs to include the address of this call
+            goto execution_error;
+
+        fvm_registers[CSP] = files[CST].length - 1; // Push CEA onto the Callstack
+        files[CST].self[fvm_registers[CSP]] = cea;
+
+        cea = HANDLER_SLOT.operand - 1;
+
+        HANDLER_EXIT(1);
+    HANDLER(DECODED_RETURN): // rt
+        if(!(fvm_registers[CSP] + 1)) { // If there is nothing to pop from the Callstack
+            fprintf(stderr, "fvmr -> Callstack underflow");
+
+            goto execution_error;
+        }
+
+        files[CST].length = fvm_registers[CSP];
+        cea = files[CST].self[fvm_registers[CSP]--] + 1;
+
+        HANDLER_EXIT_DYNAMIC(); // The Callstack can be written to, so returns can go anywhere
+    HANDLER(DECODED_FINISH): // fi
+        goto end;
+    HANDLER(DECODED_STORE_MEM): // st, quickened for MCH = MEM
+        if(fvm_registers[MCH] != MEM) {
+            decoder_deoptimise(&HANDLER_SLOT, DECODED_STORE);
+
+            goto generic_store;
+        }
+
+        if(fvm_registers[MAR] < files[MEM].length) {
+            mem[fvm_registers[MAR]] = fvm_registers[MDR];
+
+            HANDLER_WRITTEN(fvm_registers[MAR]);
+        } else { // Main Memory has to grow
+            if(store())
+                goto execution_error;
+
+            HANDLER_RELOAD();
+        }
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_LOAD_MEM): // ld, quickened for MCH = MEM
+        if(fvm_registers[MCH] != MEM) {
+            decoder_deoptimise(&HANDLER_SLOT, DECODED_LOAD);
+
+            goto generic_load;
+        }
+
+        fvm_registers[MDR] = fvm_registers[MAR] < files[MEM].length ? mem[fvm_registers[MAR]] : paged_load(&paged, fvm_registers[MAR]);
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_STORE_CST): // st, quickened for MCH = CST
+        if(fvm_registers[MCH] != CST) {
+            decoder_deoptimise(&HANDLER_SLOT, DECODED_STORE);
+
+            goto generic_store;
+        }
+
+        if(fvm_registers[MAR] < files[CST].size && fvm_registers[MAR] < quota.callstack_limit)
+            files[CST].self[fvm_registers[MAR]] = fvm_registers[MDR];
+        else if(store()) // The Callstack has to grow, or the store is past its limit
+            goto execution_error;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_LOAD_CST): // ld, quickened for MCH = CST
+        if(fvm_registers[MCH] != CST) {
+            decoder_deoptimise(&HANDLER_SLOT, DECODED_LOAD);
+
+            goto generic_load;
+        }
+
+        fvm_registers[MDR] = fvm_registers[MAR] < files[CST].size ? files[CST].self[fvm_registers[MAR]] : 0;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_STORE_OUT_STDIO): // st, quickened for MCH = OUT, MAR = 0
+        if(fvm_registers[MCH] != OUT || fvm_registers[MAR] != 0) {
+            decoder_deoptimise(&HANDLER_SLOT, DECODED_STORE);
+
+            goto generic_store;
+        }
+
+        if(console_output != NULL)
+            putc((uint8_t)fvm_registers[MDR], console_output); // Write the lowest byte to stdout
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_LOAD_INP_STDIO): // ld, quickened for MCH = INP, MAR = 0
+        if(fvm_registers[MCH] != INP || fvm_registers[MAR] != 0) {
+            decoder_deoptimise(&HANDLER_SLOT, DECODED_LOAD);
+
+            goto generic_load;
+        }
+
+        fvm_registers[MDR] = console_input != NULL ? fgetc(console_input) : EOF; // Place a byte from stdin into MDR
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_STORE_OUT_DISK): // st, quickened for MCH = OUT, MAR = 1
+        if(fvm_registers[MCH] != OUT || fvm_registers[MAR] != 1) {
+            decoder_deoptimise(&HANDLER_SLOT, DECODED_STORE);
+
+            goto generic_store;
+        }
+
+        fwrite(&fvm_registers[MDR], sizeof(uint8_t), 1, disk); // Write the lowest byte to disk
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_LOAD_OUT_DISK): // ld, quickened for MCH = OUT, MAR = 1
+        if(fvm_registers[MCH] != OUT || fvm_registers[MAR] != 1) {
+            decoder_deoptimise(&HANDLER_SLOT, DECODED_LOAD);
+
+            goto generic_load;
+        }
+
+        fread(&fvm_registers[MDR], sizeof(uint8_t), 1, disk); // Read one byte from the disk into MDR
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_PLACE_DAT_ADD): // pl <value> dat; a+
+        HANDLER_FUSED(DECODED_PLACE_DAT_ADD);
+
+        dat = HANDLER_SLOT.operand;
+        acc += dat;
+
+        cea += 3;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_PLACE_DAT_SUB): // pl <value> dat; a-
+        HANDLER_FUSED(DECODED_PLACE_DAT_SUB);
+
+        dat = HANDLER_SLOT.operand;
+        acc -= dat;
+
+        cea += 3;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_PLACE_DAT_MUL): // pl <value> dat; a*
+        HANDLER_FUSED(DECODED_PLACE_DAT_MUL);
+
+        dat = HANDLER_SLOT.operand;
+        acc *= dat;
+
+        cea += 3;
+
+        HANDLER_NEXT();
+    HANDLER(DECODED_GT_JUMP_IF_SET): // gt; js <address>
+        HANDLER_FUSED(DECODED_GT_JUMP_IF_SET);
+
+        acc = acc > dat;
+
+        HANDLER_COMPARE_AND_JUMP(acc);
+    HANDLER(DECODED_GT_JUMP_IF_CLEAR): // gt; jc <address>
+        HANDLER_FUSED(DECODED_GT_JUMP_IF_CLEAR);
+
+        acc = acc > dat;
+
+        HANDLER_COMPARE_AND_JUMP(!acc);
+    HANDLER(DECODED_LT_JUMP_IF_SET): // lt; js <address>
+        HANDLER_FUSED(DECODED_LT_JUMP_IF_SET);
+
+        acc = acc < dat;
+
+        HANDLER_COMPARE_AND_JUMP(acc);
+    HANDLER(DECODED_LT_JUMP_IF_CLEAR): // lt; jc <address>
+        HANDLER_FUSED(DECODED_LT_JUMP_IF_CLEAR);
+
+        acc = acc < dat;
+
+        HANDLER_COMPARE_AND_JUMP(!acc);
+    HANDLER(DECODED_GE_JUMP_IF_SET): // ge; js <address>
+        HANDLER_FUSED(DECODED_GE_JUMP_IF_SET);
+
+        acc = acc >= dat;
+
+        HANDLER_COMPARE_AND_JUMP(acc);
+    HANDLER(DECODED_GE_JUMP_IF_CLEAR): // ge; jc <address>
+        HANDLER_FUSED(DECODED_GE_JUMP_IF_CLEAR);
+
+        acc = acc >= dat;
+
+        HANDLER_COMPARE_AND_JUMP(!acc);
+    HANDLER(DECODED_LE_JUMP_IF_SET): // le; js <address>
+        HANDLER_FUSED(DECODED_LE_JUMP_IF_SET);
+
+        acc = acc <= dat;
+
+        HANDLER_COMPARE_AND_JUMP(acc);
+    HANDLER(DECODED_LE_JUMP_IF_CLEAR): // le; jc <address>
+        HANDLER_FUSED(DECODED_LE_JUMP_IF_CLEAR);
+
+        acc = acc <= dat;
+
+        HANDLER_COMPARE_AND_JUMP(!acc);
+    HANDLER(DECODED_EQ_JUMP_IF_SET): // eq; js <address>
+        HANDLER_FUSED(DECODED_EQ_JUMP_IF_SET);
+
+        acc = acc == dat;
+
+        HANDLER_COMPARE_AND_JUMP(acc);
+    HANDLER(DECODED_EQ_JUMP_IF_CLEAR): // eq; jc <address>
+        HANDLER_FUSED(DECODED_EQ_JUMP_IF_CLEAR);
+
+        acc = acc == dat;
+
+        HANDLER_COMPARE_AND_JUMP(!acc);
+    HANDLER(DECODED_NE_JUMP_IF_SET): // ne; js <address>
+        HANDLER_FUSED(DECODED_NE_JUMP_IF_SET);
+
+        acc = acc != dat;
+
+        HANDLER_COMPARE_AND_JUMP(acc);
+    HANDLER(DECODED_NE_JUMP_IF_CLEAR): // ne; jc <address>
+        HANDLER_FUSED(DECODED_NE_JUMP_IF_CLEAR);
+
+        acc = acc != dat;
+
+        HANDLER_COMPARE_AND_JUMP(!acc);
+    HANDLER(DECODED_PLACE_MCH_STORE): // pl <value> mch; st
+        HANDLER_FUSED(DECODED_PLACE_MCH_STORE);
+
+        fvm_registers[MCH] = HANDLER_SLOT.operand;
+
+        cea += 3;
+
+        HANDLER_STORE();
+        HANDLER_NEXT();
+    HANDLER(DECODED_PLACE_MCH_LOAD): // pl <value> mch; ld
+        HANDLER_FUSED(DECODED_PLACE_MCH_LOAD);
+
+        fvm_registers[MCH] = HANDLER_SLOT.operand;
+
+        cea += 3;
+
+        HANDLER_LOAD();
+        HANDLER_NEXT();
+    HANDLER(DECODED_PLACE_MAR_STORE): // pl <value> mar; st
+        HANDLER_FUSED(DECODED_PLACE_MAR_STORE);
+
+        fvm_registers[MAR] = HANDLER_SLOT.operand;
+
+        cea += 3;
+
+        HANDLER_STORE();
+        HANDLER_NEXT();
+    HANDLER(DECODED_PLACE_MAR_LOAD): // pl <value> mar; ld
+        HANDLER_FUSED(DECODED_PLACE_MAR_LOAD);
+
+        fvm_registers[MAR] = HANDLER_SLOT.operand;
+
+        cea += 3;
+
+        HANDLER_LOAD();
+        HANDLER_NEXT();
+    HANDLER(DECODED_PLACE_MDR_STORE): // pl <value> mdr; st
+        HANDLER_FUSED(DECODED_PLACE_MDR_STORE);
+
+        fvm_registers[MDR] = HANDLER_SLOT.operand;
+
+        cea += 3;
+
+        HANDLER_STORE();
+        HANDLER_NEXT();
@@ -0,0 +1,159 @@
+/* Fox Virtual Machine: Decoded Instruction Handlers
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// The engines that run the decoded stream (threaded.c, block.c) share the handlers for its ops, which are kept in
+// handler_bodies.h and included into the body of each engine's run function. An engine including them provides:
+//
+//     HANDLER(op)               The label or case for op
+//     HANDLER_SLOT              The decoded_instruction being executed
+//     HANDLER_NEXT()            Carry on after an instruction that doesn't transfer control
+//     HANDLER_EXIT(taken)       Carry on after a jump or call whose target the decoder checked (taken is 1 if it went to
+//                               the target, 0 if it fell through)
+//     HANDLER_EXIT_DYNAMIC()    Carry on after a jump to somewhere only known at runtime (rt, mv into CEA)
+//     HANDLER_WRITTEN(address)  Called after a write to Main Memory that didn't go through store()
+//     HANDLER_RELOAD()          Called after store(), which can reallocate Main Memory
+//
+// as well as the locals mem, cea, acc, dat and value, the labels execution_error and end, and a handler of its own for
+// DECODED_UNDECODED. Every handler leaves cea on the last cell of its instruction, exactly as instructions[] leaves CEA,
+// so that tracebacks from every engine agree.
+
+#ifndef FVMR_HANDLERS_H
+
+#define FVMR_HANDLERS_H
+
+#include "global.h"
+#include "instructions.h"
+
+#if defined(__GNUC__) && !defined(FVMR_NO_COMPUTED_GOTO) // Use labels-as-values where the compiler has them, otherwise fall back to a switch
+#define FVMR_COMPUTED_GOTO
+#endif
+
+#define HANDLER_LABELS /* Designated initialisers for a label table of every op but DECODED_UNDECODED */ \
+        [DECODED_PLACE] = &&handler_DECODED_PLACE, \
+        [DECODED_PLACE_ACC] = &&handler_DECODED_PLACE_ACC, \
+        [DECODED_PLACE_DAT] = &&handler_DECODED_PLACE_DAT, \
+        [DECODED_PLACE_CEA] = &&handler_DECODED_PLACE_CEA, \
+        [DECODED_MOVE] = &&handler_DECODED_MOVE, \
+        [DECODED_MOVE_TO_ACC] = &&handler_DECODED_MOVE_TO_ACC, \
+        [DECODED_MOVE_FROM_ACC] = &&handler_DECODED_MOVE_FROM_ACC, \
+        [DECODED_MOVE_ANY] = &&handler_DECODED_MOVE_ANY, \
+        [DECODED_STORE] = &&handler_DECODED_STORE, \
+        [DECODED_LOAD] = &&handler_DECODED_LOAD, \
+        [DECODED_JUMP] = &&handler_DECODED_JUMP, \
+        [DECODED_JUMP_IF_SET] = &&handler_DECODED_JUMP_IF_SET, \
+        [DECODED_JUMP_IF_CLEAR] = &&handler_DECODED_JUMP_IF_CLEAR, \
+        [DECODED_ACCUMULATOR_ADD] = &&handler_DECODED_ACCUMULATOR_ADD, \
+        [DECODED_ACCUMULATOR_SUB] = &&handler_DECODED_ACCUMULATOR_SUB, \
+        [DECODED_ACCUMULATOR_NOT] = &&handler_DECODED_ACCUMULATOR_NOT, \
+        [DECODED_ACCUMULATOR_INCREMENT] = &&handler_DECODED_ACCUMULATOR_INCREMENT, \
+        [DECODED_ACCUMULATOR_DECREMENT] = &&handler_DECODED_ACCUMULATOR_DECREMENT, \
+        [DECODED_ACCUMULATOR_MUL] = &&handler_DECODED_ACCUMULATOR_MUL, \
+        [DECODED_ACCUMULATOR_DIV] = &&handler_DECODED_ACCUMULATOR_DIV, \
+        [DECODED_ACCUMULATOR_AND] = &&handler_DECODED_ACCUMULATOR_AND, \
+        [DECODED_ACCUMULATOR_OR] = &&handler_DECODED_ACCUMULATOR_OR, \
+        [DECODED_ACCUMULATOR_XOR] = &&handler_DECODED_ACCUMULATOR_XOR, \
+        [DECODED_ACCUMULATOR_LSH] = &&handler_DECODED_ACCUMULATOR_LSH, \
+        [DECODED_ACCUMULATOR_RSH] = &&handler_DECODED_ACCUMULATOR_RSH, \
+        [DECODED_ACCUMULATOR_GT] = &&handler_DECODED_ACCUMULATOR_GT, \
+        [DECODED_ACCUMULATOR_LT] = &&handler_DECODED_ACCUMULATOR_LT, \
+        [DECODED_ACCUMULATOR_GE] = &&handler_DECODED_ACCUMULATOR_GE, \
+        [DECODED_ACCUMULATOR_LE] = &&handler_DECODED_ACCUMULATOR_LE, \
+        [DECODED_ACCUMULATOR_EQ] = &&handler_DECODED_ACCUMULATOR_EQ, \
+        [DECODED_ACCUMULATOR_NE] = &&handler_DECODED_ACCUMULATOR_NE, \
+        [DECODED_CALL] = &&handler_DECODED_CALL, \
+        [DECODED_RETURN] = &&handler_DECODED_RETURN, \
+        [DECODED_FINISH] = &&handler_DECODED_FINISH, \
+        [DECODED_STORE_MEM] = &&handler_DECODED_STORE_MEM, \
+        [DECODED_LOAD_MEM] = &&handler_DECODED_LOAD_MEM, \
+        [DECODED_STORE_CST] = &&handler_DECODED_STORE_CST, \
+        [DECODED_LOAD_CST] = &&handler_DECODED_LOAD_CST, \
+        [DECODED_STORE_OUT_STDIO] = &&handler_DECODED_STORE_OUT_STDIO, \
+        [DECODED_LOAD_INP_STDIO] = &&handler_DECODED_LOAD_INP_STDIO, \
+        [DECODED_STORE_OUT_DISK] = &&handler_DECODED_STORE_OUT_DISK, \
+        [DECODED_LOAD_OUT_DISK] = &&handler_DECODED_LOAD_OUT_DISK, \
+        [DECODED_PLACE_DAT_ADD] = &&handler_DECODED_PLACE_DAT_ADD, \
+        [DECODED_PLACE_DAT_SUB] = &&handler_DECODED_PLACE_DAT_SUB, \
+        [DECODED_PLACE_DAT_MUL] = &&handler_DECODED_PLACE_DAT_MUL, \
+        [DECODED_GT_JUMP_IF_SET] = &&handler_DECODED_GT_JUMP_IF_SET, \
+        [DECODED_GT_JUMP_IF_CLEAR] = &&handler_DECODED_GT_JUMP_IF_CLEAR, \
+        [DECODED_LT_JUMP_IF_SET] = &&handler_DECODED_LT_JUMP_IF_SET, \
+        [DECODED_LT_JUMP_IF_CLEAR] = &&handler_DECODED_LT_JUMP_IF_CLEAR, \
+        [DECODED_GE_JUMP_IF_SET] = &&handler_DECODED_GE_JUMP_IF_SET, \
+        [DECODED_GE_JUMP_IF_CLEAR] = &&handler_DECODED_GE_JUMP_IF_CLEAR, \
+        [DECODED_LE_JUMP_IF_SET] = &&handler_DECODED_LE_JUMP_IF_SET, \
+        [DECODED_LE_JUMP_IF_CLEAR] = &&handler_DECODED_LE_JUMP_IF_CLEAR, \
+        [DECODED_EQ_JUMP_IF_SET] = &&handler_DECODED_EQ_JUMP_IF_SET, \
+        [DECODED_EQ_JUMP_IF_CLEAR] = &&handler_DECODED_EQ_JUMP_IF_CLEAR, \
+        [DECODED_NE_JUMP_IF_SET] = &&handler_DECODED_NE_JUMP_IF_SET, \
+        [DECODED_NE_JUMP_IF_CLEAR] = &&handler_DECODED_NE_JUMP_IF_CLEAR, \
+        [DECODED_PLACE_MCH_STORE] = &&handler_DECODED_PLACE_MCH_STORE, \
+        [DECODED_PLACE_MCH_LOAD] = &&handler_DECODED_PLACE_MCH_LOAD, \
+        [DECODED_PLACE_MAR_STORE] = &&handler_DECODED_PLACE_MAR_STORE, \
+        [DECODED_PLACE_MAR_LOAD] = &&handler_DECODED_PLACE_MAR_LOAD, \
+        [DECODED_PLACE_MDR_STORE] = &&handler_DECODED_PLACE_MDR_STORE,
+
+#define HANDLER_FUSED(op) do { /* Count a fused op, which stands for two instructions */ \
+        decoder.fused[(op) - DECODED_FIRST_FUSED]++; \
+        executed++; \
+    } while(0)
+
+#define HANDLER_COMPARE_AND_JUMP(taken) do { /* The jump half of a fused compare and js/jc, from the compare's slot */ \
+        if(taken) { \
+            cea = HANDLER_SLOT.operand - 1; \
+            \
+            HANDLER_EXIT(1); \
+        } \
+        \
+        cea += 2; \
+        \
+        HANDLER_EXIT(0); \
+    } while(0)
+
+#define HANDLER_STORE() do { /* st, with cea on it */ \
+        if(fvm_registers[MCH] == MEM && fvm_registers[MAR] < files[MEM].length) { /* Writes to Main Memory that don't need it to grow are done here */ \
+            mem[fvm_registers[MAR]] = fvm_registers[MDR]; \
+            \
+            HANDLER_WRITTEN(fvm_registers[MAR]); \
+        } else { /* Anything else is left to store() */ \
+            if(store()) \
+                goto execution_error; \
+            \
+            HANDLER_RELOAD(); \
+        } \
+    } while(0)
+
+#define HANDLER_LOAD() do { /* ld, with cea on it */ \
+        if(fvm_registers[MCH] == MEM) { /* Reads from Main Memory are done here, going to paged memory past its end */ \
+            fvm_registers[MDR] = fvm_registers[MAR] < files[MEM].length ? mem[fvm_registers[MAR]] : paged_load(&paged, fvm_registers[MAR]); \
+        } else { /* Anything else is left to load() */ \
+            if(load()) \
+                goto execution_error; \
+            \
+            HANDLER_RELOAD(); /* (The heap allocator can grow Main Memory) */ \
+        } \
+    } while(0)
+
+#define HANDLER_READ(r) ((r) == ACC ? acc : (r) == DAT ? dat : (r) == CEA ? cea : fvm_registers[r]) // Read a register, wherever it's currently held
+
+#define HANDLER_WRITE(r, value) do { /* Write a register, wherever it's currently held */ \
+        switch(r) { \
+            case ACC: \
+                acc = (value); \
+                break; \
+            case DAT: \
+                dat = (value); \
+                break; \
+            case CEA: \
+                cea = (value); \
+                break; \
+            default: \
+                fvm_registers[r] = (value); \
+        } \
+    } while(0)
+
+#endif
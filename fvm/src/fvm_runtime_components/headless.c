@@ -0,0 +1,238 @@
+/* Fox Virtual Machine: Headless Screen and Keyboard
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// Stands in for fvmgl.c when built with FVMR_HEADLESS (the fvmr-headless target), so that nothing links against GLFW or
+// GL. The screen keeps the state that commands can read back (its dimensions), and the keyboard is fvmkbd.c as usual,
+// with its queue filled from the keyboard file up front rather than by a GLFW callback. There are no window events, so polling never does anything.
+
+#ifdef FVMR_HEADLESS
+
+#include "headless.h"
+
+#include <ctype.h>
+#include <errno.h>
+
+static const char *HEADLESS_COMMAND_NAMES[] = { // Names of the screen buffer commands, for the report
+    [FVMGL_SET_WINDOW_DIMENSIONS] = "Set window dimensions",
+    [FVMGL_SET_WORKING_DIMENSIONS] = "Set working dimensions",
+    [FVMGL_SET_WINDOW_TITLE] = "Set window title",
+    [FVMGL_SET_WINDOW_VISIBILITY] = "Set window visibility",
+    [FVMGL_SET_WINDOW_FULLSCREEN] = "Set window fullscreen",
+    [FVMGL_SET_WINDOW_VSYNC] = "Set window vsync",
+    [FVMGL_DRAW_TRIANGLE] = "Draw triangle",
+    [FVMGL_SWAP_BUFFERS] = "Swap buffers",
+    [FVMGL_SET_PROJECTION] = "Set projection",
+    [FVMGL_CLEAR_BUFFERS] = "Clear buffers",
+    [FVMGL_GET_WINDOW_SHOULD_CLOSE] = "Get window should close",
+    [FVMGL_GET_WINDOW_DIMENSIONS] = "Get window dimensions",
+    [FVMGL_WAIT_EVENTS] = "Wait for events",
+    [FVMGL_WAIT_FRAME] = "Wait for frame"
+};
+
+static char headless_window; // What fvmgl_screen_object.window points to once the screen is initialised, since there's no GLFW window for it to be
+
+struct fvmr_headless headless = {
+    .commands = {0},
+    .keypresses = 0
+};
+
+FVMR_VM_STATE struct fvmgl_screen fvmgl_screen_object = FVMGL_SCREEN_DEFAULTS;
+
+struct fvmgl_polling fvmgl_polling = {
+    .every = UINT64_MAX,
+    .interval = 0,
+    .next = UINT64_MAX,
+    .keyboard_next = 0,
+    .requested = 0,
+    .timed = 0
+};
+
+_Bool headless_init(const char *keyboard) { // Queue up the keypresses in the keyboard file
+    FILE *f;
+    char line[256],
+         *cursor,
+         extra;
+    long key,
+         action,
+         modifiers;
+    uint64_t line_no = 0;
+
+    if(keyboard == NULL)
+        return 0;
+
+    if((f = fopen(keyboard, "r")) == NULL) {
+        perror("fvmr -> Could not access keyboard file");
+
+        return 1;
+    }
+
+    while(fgets(line, sizeof(line), f) != NULL) {
+        line_no++;
+
+        for(cursor = line; isspace((unsigned char)*cursor); cursor++);
+
+        if(!*cursor || *cursor == '#') // Blank line or comment
+            continue;
+
+        action = 1; // GLFW_PRESS
+        modifiers = 0;
+
+        if(sscanf(cursor, "%ld %ld %ld %c", &key, &action, &modifiers, &extra) > 3 || !isdigit((unsigned char)*cursor)) {
+            fprintf(stderr, "fvmr -> Expected '<key> [<action> [<modifiers>]]' on line %zu of keyboard file\n", line_no);
+
+            fclose(f);
+
+            return 1;
+        }
+
+        fvmkbd_enqueue_keypress((struct fvmkbd_keypress){ // Kept by fvmkbd_init() when the keyboard is first used
+            .key = key,
+            .scancode = key,
+            .action = action,
+            .modifiers = modifiers
+        });
+
+        headless.keypresses++;
+    }
+
+    fclose(f);
+
+    return fvmkbd.errors;
+}
+
+static double headless_time(void) { // Seconds on the screen's clock
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void headless_sleep(double seconds) { // Sleep for seconds, carrying on after any signal
+    struct timespec remaining = {.tv_sec = (time_t)seconds, .tv_nsec = (long)((seconds - (time_t)seconds) * 1e9)};
+
+    while(nanosleep(&remaining, &remaining) && errno == EINTR);
+}
+
+_Bool fvmgl_init(void) { // Setup function, which only has the screen's defaults to set up
+    fvmgl_screen_object.window = (GLFWwindow *)&headless_window;
+
+    return 0;
+}
+
+_Bool fvmgl_require(void) { // Initialise the screen and keyboard on first use
+    if(!fvmgl_screen_object.deferred)
+        return 0;
+
+    fvmgl_screen_object.deferred = 0;
+
+    if(fvmgl_init())
+        return 1;
+
+    if(fvmkbd_init(fvmgl_screen_object.window)) {
+        fprintf(stderr, "fvmr -> Keyboard API -> Failed to initialise.\n");
+
+        return 1;
+    }
+
+    return 0;
+}
+
+_Bool fvmgl_update(uint64_t *data) { // Handle calls from the program running on the VM, keeping only what can be read back
+    double now;
+
+    if(data[0] >= FVMGL_NO_INSTRUCTIONS) {
+        fprintf(stderr,
+                "fvmr -> Graphics API -> Got invalid instruction '%zu'!\n",
+                data[0]);
+
+        return 1;
+    }
+
+    headless.commands[data[0]]++;
+
+    switch(data[0]) {
+        case FVMGL_SET_WINDOW_DIMENSIONS:
+            fvmgl_screen_object.window_width = data[1],
+            fvmgl_screen_object.window_height = data[2];
+
+            return 0;
+        case FVMGL_SET_WORKING_DIMENSIONS:
+            fvmgl_screen_object.working_width = data[1],
+            fvmgl_screen_object.working_height = data[2],
+            fvmgl_screen_object.working_depth = data[3];
+
+            return 0;
+        case FVMGL_SET_PROJECTION:
+            fvmgl_screen_object.perspective = data[1];
+
+            return 0;
+        case FVMGL_GET_WINDOW_SHOULD_CLOSE: // Never, so a ROM that draws until it's closed runs until it's stopped some other way (such as by --max-seconds=)
+            data[1] = 0;
+
+            return 0;
+        case FVMGL_GET_WINDOW_DIMENSIONS:
+            data[1] = fvmgl_screen_object.window_width,
+            data[2] = fvmgl_screen_object.window_height;
+
+            return 0;
+        case FVMGL_WAIT_EVENTS: // No keypress can arrive that isn't queued already, so only the timeout is waited for (and not even that without one, since it would never end)
+            if(!fvmkbd.keypress_queue_length && data[1])
+                headless_sleep(data[1] / 1e3);
+
+            return 0;
+        case FVMGL_WAIT_FRAME:
+            now = headless_time();
+
+            fvmgl_screen_object.frame_deadline += data[1] / 1e6;
+
+            if(fvmgl_screen_object.frame_deadline < now) // Behind (or the first frame), so counted again from now
+                fvmgl_screen_object.frame_deadline = now;
+
+            headless_sleep(fvmgl_screen_object.frame_deadline - now);
+
+            return 0;
+        default: // Drawing and anything else that only changes what would be shown
+            return 0;
+    }
+}
+
+void fvmgl_poll_init(uint64_t every, uint64_t interval) { // Nothing is ever polled for
+    (void)every;
+    (void)interval;
+}
+
+_Bool fvmgl_poll(void) { // Nothing to poll for
+    return fvmgl_screen_object.errors;
+}
+
+_Bool fvmgl_poll_keyboard(void) { // Nothing to poll for
+    return fvmgl_screen_object.errors;
+}
+
+_Bool fvmgl_tick(uint64_t executed) { // Nothing to poll for
+    (void)executed;
+
+    return fvmgl_screen_object.errors;
+}
+
+void fvmgl_poll_end(void) { // Nothing to stop
+}
+
+void fvmgl_end(void) { // Nothing to clean up
+}
+
+void headless_report(void) { // Print the screen buffer commands handled, and keypresses read
+    fprintf(stderr, "\tKeypresses read: %zu\n", headless.keypresses);
+
+    for(int i = 0; i < FVMGL_NO_INSTRUCTIONS; i++)
+        if(headless.commands[i])
+            fprintf(stderr, "\tScreen buffer, %s: %zu\n", HEADLESS_COMMAND_NAMES[i], headless.commands[i]);
+}
+
+#endif
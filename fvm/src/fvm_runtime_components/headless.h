@@ -0,0 +1,21 @@
+#ifndef FVMR_HEADLESS_H
+
+#define FVMR_HEADLESS_H
+
+#include "global.h"
+#include "fvmgl.h"
+#include "fvmkbd.h"
+
+// Keyboard files (--keyboard=) have one keypress per line, as "<key> [<action> [<modifiers>]]", with the GLFW values for each (the
+// action being a press if left out, and the modifiers none). Keys are their own scancodes. Blank lines and lines starting
+// with '#' are skipped.
+
+extern struct fvmr_headless { // The screen buffer and keyboard of fvmr-headless, which has no window: commands to the screen buffer are counted and otherwise discarded, and keypresses are read from a file
+    uint64_t commands[FVMGL_NO_INSTRUCTIONS], // Screen buffer commands handled, by instruction
+             keypresses; // Number read from the keyboard file
+} headless;
+
+extern _Bool headless_init(const char *keyboard); // Queue up the keypresses in the keyboard file (none if NULL), ready for the keyboard's first use, returns 1 on failure
+extern void headless_report(void); // Print how many of each screen buffer command were handled, and how many keypresses were read
+
+#endif
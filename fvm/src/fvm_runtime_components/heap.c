@@ -0,0 +1,176 @@
+/* Fox Virtual Machine: Heap Allocator
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// Everything the heap writes goes through memory_store() (or bulk_copy(), for a copy), so that blocks can be
+// paged, count towards the Main Memory limit, and hold code that the engines see change, just as if the guest had
+// written them itself. Only the free list heads and the extent of the heap are kept natively (and in checkpoints).
+
+#include "heap.h"
+#include "instructions.h"
+
+FVMR_VM_STATE struct fvmr_heap heap = HEAP_DEFAULTS;
+
+static uint64_t heap_class(uint64_t cells) { // Smallest class whose blocks hold cells (which is at least 1)
+    uint64_t shift;
+
+    if(cells <= 8)
+        return cells - 1;
+
+    shift = 63 - __builtin_clzll(cells - 1) - 2; // So that (cells - 1) >> shift is between 4 and 7
+
+    return 8 + (shift - 1) * 4 + ((cells - 1) >> shift) - 4;
+}
+
+static uint64_t heap_cells(uint64_t class) { // Cells in a block of class
+    if(class < 8)
+        return class + 1;
+
+    return ((class - 8) % 4 + 5) << ((class - 8) / 4 + 1);
+}
+
+static _Bool heap_block(uint64_t address, uint64_t *class) { // Read the class of the allocated block at address into *class, returns 1 (having reported it) if there's no such block
+    uint64_t header;
+
+    if(heap.base && address > heap.base && address < heap.top) {
+        header = memory_load(address - 1);
+
+        if((header & ~(HEAP_USED | 0xFF)) == HEAP_MAGIC && header & HEAP_USED && (header & 0xFF) < HEAP_CLASSES && address + heap_cells(header & 0xFF) <= heap.top) {
+            *class = header & 0xFF;
+
+            return 0;
+        }
+    }
+
+    fprintf(stderr, "fvmr -> Attempted to free or reallocate address %zu, which isn't an allocated block\n", address);
+
+    return 1;
+}
+
+static _Bool heap_alloc(uint64_t cells, uint64_t *address) { // Allocate a block of at least cells into *address (0 if there isn't the memory for it), returns 1 (having reported why) on failure
+    uint64_t class,
+             next;
+
+    *address = 0;
+
+    if(cells > HEAP_MAX_CELLS)
+        return 0;
+
+    class = heap_class(cells);
+
+    if(heap.free[class]) { // Reuse the last block freed in the class
+        next = memory_load(heap.free[class]);
+
+        if(next && (next <= heap.base || next >= heap.top)) {
+            fprintf(stderr, "fvmr -> Found the heap to be corrupt, at the free block at address %zu\n", heap.free[class]);
+
+            return 1;
+        }
+
+        *address = heap.free[class];
+        heap.free[class] = next;
+    } else { // Or make a new one on top of the heap
+        if(!heap.base)
+            heap.base = heap.top = files[MEM].length;
+
+        if(heap.top < files[MEM].length) // Over anything the guest put past the heap itself
+            heap.top = files[MEM].length;
+
+        if(quota_memory_exceeded(heap.top + heap_cells(class))) // The whole block has to fit, even if it isn't all written to
+            return 0;
+
+        *address = heap.top + 1;
+        heap.top = *address + heap_cells(class);
+    }
+
+    heap.allocations++;
+
+    return memory_store(*address - 1, HEAP_MAGIC | HEAP_USED | class);
+}
+
+static _Bool heap_free(uint64_t address) { // Put the block at address on its free list, returns 1 (having reported why) on failure
+    uint64_t class;
+
+    if(!address)
+        return 0;
+
+    if(heap_block(address, &class) || memory_store(address - 1, HEAP_MAGIC | class) || memory_store(address, heap.free[class]))
+        return 1;
+
+    heap.free[class] = address;
+    heap.frees++;
+
+    return 0;
+}
+
+static _Bool heap_realloc(uint64_t address, uint64_t cells, uint64_t *moved_to) { // Reallocate the block at address (or allocate one, if it's 0) to hold cells, with its new address in *moved_to (0 if there isn't the memory for it, leaving the block as it was), returns 1 (having reported why) on failure
+    uint64_t class,
+             grown;
+
+    if(!address)
+        return heap_alloc(cells, moved_to);
+
+    if(heap_block(address, &class))
+        return 1;
+
+    heap.reallocations++;
+
+    *moved_to = address;
+
+    if(cells <= heap_cells(class)) // Already big enough (and it's never shrunk)
+        return 0;
+
+    *moved_to = 0;
+
+    if(cells > HEAP_MAX_CELLS)
+        return 0;
+
+    if(address + heap_cells(class) == heap.top && files[MEM].length <= heap.top) { // The last block grows in place
+        grown = heap_class(cells);
+
+        if(quota_memory_exceeded(address + heap_cells(grown) - 1))
+            return 0;
+
+        heap.top = address + heap_cells(grown);
+
+        *moved_to = address;
+
+        return memory_store(address - 1, HEAP_MAGIC | HEAP_USED | grown);
+    }
+
+    if(heap_alloc(cells, moved_to))
+        return 1;
+
+    if(!*moved_to)
+        return 0;
+
+    heap.moved++;
+
+    return bulk_copy(*moved_to, address, heap_cells(class)) || heap_free(address);
+}
+
+_Bool heap_load(void) { // ld on ALC
+    uint64_t address;
+
+    if(heap_realloc(fvm_registers[MAR], fvm_registers[MDR] ? fvm_registers[MDR] : 1, &address))
+        return 1;
+
+    fvm_registers[MDR] = address;
+
+    return 0;
+}
+
+_Bool heap_store(void) { // st on ALC
+    return heap_free(fvm_registers[MAR]);
+}
+
+void heap_report(void) { // Print how much the heap was used
+    if(!heap.base)
+        return;
+
+    fprintf(stderr, "\tHeap: %zu cells from address %zu, with %zu allocations, %zu frees and %zu reallocations (%zu moved)\n", heap.top - heap.base, heap.base, heap.allocations, heap.frees, heap.reallocations, heap.moved);
+}
@@ -0,0 +1,48 @@
+#ifndef FVMR_HEAP_H
+
+#define FVMR_HEAP_H
+
+// The allocator channel (MCH ALC) gives guests malloc(), realloc() and free() over their own Main Memory, in native code:
+//   ld on ALC: MDR = realloc(MAR, MDR), allocating MDR cells afresh if MAR is 0. MDR is 0 if there isn't the memory for it
+//   st on ALC: free(MAR), where freeing 0 does nothing
+// Blocks aren't zeroed when they're reused, and a MDR of 0 asks for 1 cell. Freeing or reallocating an address that isn't
+// an allocated block fails like any other bad st or ld.
+//
+// The heap starts at the end of Main Memory when the first allocation is made, and grows upward from there, so a guest
+// using it keeps its own data below that (or out of its way, well above it). Each block is preceded by a header cell
+// saying which size class it's in and whether it's allocated. Freed blocks go onto a free list for their class, linked
+// through their first cell, and are reused as they are by the next allocation in that class, so that most allocations
+// and frees are a few cells' work. Blocks are never split or merged, but the last block grows in place when reallocated.
+
+#include "global.h"
+
+#define HEAP_CLASSES 192 // Size classes: exactly 1 to 8 cells, then 4 to each doubling, up to HEAP_MAX_CELLS
+#define HEAP_MAX_CELLS ((uint64_t)1 << 48) // Largest block that can be allocated
+#define HEAP_MAGIC UINT64_C(0x4845415000000000) // "HEAP" in the top of every header, so that freeing something that was never allocated is caught
+#define HEAP_USED ((uint64_t)1 << 8) // Set in the header of an allocated block, below which is its class
+
+#define HEAP_DEFAULTS { /* No heap until the first allocation */ \
+    .base = 0, \
+    .top = 0, \
+    .free = {0}, \
+    .allocations = 0, \
+    .frees = 0, \
+    .reallocations = 0, \
+    .moved = 0 \
+}
+
+extern FVMR_VM_STATE struct fvmr_heap { // The guest's heap in Main Memory
+    uint64_t base, // Address of the first block's header (0 until the first allocation)
+             top, // Address just past the last block
+             free[HEAP_CLASSES], // Address of the first free block in each class (0 for none)
+             allocations, // Counts of each operation, for --stats
+             frees,
+             reallocations,
+             moved; // Reallocations that had to copy the block somewhere else
+} heap;
+
+extern _Bool heap_load(void); // ld on ALC: MDR = realloc(MAR, MDR), returns 1 (having reported why) on failure
+extern _Bool heap_store(void); // st on ALC: free(MAR), returns 1 (having reported why) on failure
+extern void heap_report(void); // Print how much the heap was used
+
+#endif
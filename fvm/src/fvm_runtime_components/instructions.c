@@ -38,6 +38,33 @@ _Bool (*instructions[NO_INSTRUCTIONS])(void) = {
 	[26] = &return_address
 };
 
+void table_run(void) { // Execute from CEA by dispatching each instruction through instructions[]
+	uint64_t executed = 0;
+
+	for(; files[MEM].self[fvm_registers[CEA]] != 27; fvm_registers[CEA]++) { // Traverse instructions until instruction 27 (fi - finish) is encountered
+		if(files[MEM].self[fvm_registers[CEA]] >= NO_INSTRUCTIONS) { // If a number is encountered that should be an instruction but isn't in the instructions list
+			fprintf(stderr, "fvmr -> Encountered unknown instruction '%zu'\n", files[MEM].self[fvm_registers[CEA]]);
+
+			fvmr_exit_code = FVMR_EXIT_FAILURE_EXECUTION;
+
+			break;
+		}
+
+		if(instructions[files[MEM].self[fvm_registers[CEA]]]()) { // Otherwise, try to execute the current instruction. If it returns a failed status, exit safely
+			fvmr_exit_code = FVMR_EXIT_FAILURE_EXECUTION;
+
+			break;
+		}
+
+		executed++;
+
+		if(SERVICE_DUE(executed) && service_run(fvm_registers[CEA] + 1, executed)) // Every register is already in fvm_registers
+			break;
+	}
+
+	fvmr_stats.instructions += executed;
+}
+
 _Bool place(void) { // pl <value> <register>
 //    printf("place %zu in %zu\n", files[MEM].self[fvm_registers[CEA] + 1], files[MEM].self[fvm_registers[CEA] + 2]);
 
@@ -85,43 +112,112 @@ _Bool move(void) { // mv <register> <register>
 	return 0;
 }
 
-_Bool store(void) { // st <mdr> at <mar> in <mch>
-//    printf("store %zu at %zu in %zu\n", fvm_registers[MDR], fvm_registers[MAR], fvm_registers[MCH]);
+static _Bool missing_disk(void) { // Report an access to the disk of a VM that was made without one, returns 1 for convenience
+    fprintf(stderr, "fvmr -> Attempted to use the disk, but this VM has no disk\n");
 
-    switch(fvm_registers[MCH]) { // Depending on the Memory Channel, write in a different way
-        case MEM: // For Main Memory:
-            if(fvm_registers[MAR] + 1 > files[MEM].length) { // If the address is bigger than what's used
-                files[MEM].length = fvm_registers[MAR] + 1;
+    return 1;
+}
 
-                if(files[MEM].length > files[MEM].size) { // If it's bigger than what's allocated
-                    files[MEM].size = files[MEM].length;
+_Bool store_screen_buffer(void) { // Pass the command at MDR in Main Memory to fvmgl
+    if(fvmgl_require())
+        return 1;
 
-                    if((alloc_buff = (void *)realloc(files[MEM].self, files[MEM].size * sizeof(uint64_t))) == NULL) { // Attempt to reallocate Main Memory more space to accomodate the write
-                        perror("fvmr -> Failure accessing memory at specified address");
+    if(fvmgl_screen_object.window == NULL) {
+        fprintf(stderr, "fvmr -> Attempted to use the screen buffer, but this VM has no screen\n");
 
-                        return 1;
-                    }
+        return 1;
+    }
 
-                    files[MEM].self = (uint64_t *)alloc_buff;
-                }
-            }
+    if(fvmgl_update(&files[MEM].self[fvm_registers[MDR]]))
+        return 1;
 
-            files[MEM].self[fvm_registers[MAR]] = fvm_registers[MDR]; // Store MDR at address MAR in Main Memory
+    if(decoder.code != NULL) { // Some commands write their results back into the cells after them
+        decoder_invalidate(fvm_registers[MDR] + 1);
+        decoder_invalidate(fvm_registers[MDR] + 2);
+    }
 
-            return 0;
+    if(blocks.table != NULL) {
+        block_invalidate(fvm_registers[MDR] + 1);
+        block_invalidate(fvm_registers[MDR] + 2);
+    }
+
+    return 0;
+}
+
+_Bool memory_store(uint64_t address, uint64_t value) { // Write value to address in Main Memory
+    if(address < files[MEM].length) { // If the address is within what's used
+        files[MEM].self[address] = value;
+    } else if(quota_memory(address)) { // Refuse to go past its limit
+        return 1;
+    } else if(paged_store(&files[MEM], &paged, address, value)) { // Otherwise attempt to grow Main Memory to accomodate the write, or put it in paged memory if it's too far away
+        perror("fvmr -> Failure accessing memory at specified address");
+
+        return 1;
+    }
+
+    if(decoder.code != NULL) { // Keep the decoded instructions in step with Main Memory
+        if(decoder_resize())
+            return 1;
+
+        decoder_invalidate(address);
+    }
+
+    if(blocks.table != NULL) { // And the blocks copied out of them
+        if(block_resize())
+            return 1;
+
+        block_invalidate(address);
+    }
+
+    return 0;
+}
+
+_Bool memory_store_byte(uint64_t address, uint8_t value) { // Write value to byte address in Main Memory
+    uint64_t shift = (address & 7) * 8;
+
+    return memory_store(address >> 3, (memory_load(address >> 3) & ~((uint64_t)0xFF << shift)) | (uint64_t)value << shift);
+}
+
+void memory_invalidate(uint64_t from, uint64_t to) { // Forget what was decoded from the cells from from up to to
+    if(decoder.code != NULL)
+        for(uint64_t i = from; i < to && i < decoder.extent; i++)
+            decoder_invalidate(i);
+
+    if(blocks.table != NULL)
+        for(uint64_t i = from; i < to && i < blocks.length; i++) {
+            if(!blocks.pages[i >> BLOCK_PAGE_SHIFT >> 6]) // Skip over a whole word of the code bitmap with no code on it
+                i |= ((uint64_t)1 << BLOCK_PAGE_SHIFT << 6) - 1;
+            else
+                block_invalidate(i);
+        }
+}
+
+_Bool store(void) { // st <mdr> at <mar> in <mch>
+//    printf("store %zu at %zu in %zu\n", fvm_registers[MDR], fvm_registers[MAR], fvm_registers[MCH]);
+
+    switch(fvm_registers[MCH]) { // Depending on the Memory Channel, write in a different way
+        case MEM: // For Main Memory:
+            return memory_store(fvm_registers[MAR], fvm_registers[MDR]); // Store MDR at address MAR in Main Memory
         case INP: // For Input:
             switch(fvm_registers[MAR]) { // Write to input in a different place depending on MAR
                 case 0: // For Standard I/O
-                    fprintf(stdin, "%c", (uint8_t)fvm_registers[MDR]); // Write the lowest byte to stdin
+                    if(console_input != NULL)
+                        fprintf(console_input, "%c", (uint8_t)fvm_registers[MDR]); // Write the lowest byte to stdin
 
                     return 0;
                 case 1: // For disk:
+                    if(disk == NULL)
+                        return missing_disk();
+
                     fseek(disk, fvm_registers[MDR], SEEK_SET); // Set the offset from the beginning of the disk to MDR
 
                     return 0;
                 case 2: // For screen buffer:
-                    return fvmgl_update(&files[MEM].self[fvm_registers[MDR]]);
+                    return store_screen_buffer();
                 case 3: // For Keyboard:
+                    if(fvmgl_require())
+                        return 1;
+
                     fvmkbd_get_next_keypress_as_scancode();
 
                     return 0;
@@ -133,16 +229,23 @@ _Bool store(void) { // st <mdr> at <mar> in <mch>
         case OUT: // For Output:
             switch(fvm_registers[MAR]) { // Write to output in a different place depending on MAR
                 case 0: // For Standard I/O
-                    fprintf(stdout, "%c", (uint8_t)fvm_registers[MDR]); // Write the lowest byte to stdout
+                    if(console_output != NULL)
+                        fprintf(console_output, "%c", (uint8_t)fvm_registers[MDR]); // Write the lowest byte to stdout
 
                     return 0;
                 case 1: // For disk:
+                    if(disk == NULL)
+                        return missing_disk();
+
                     fwrite(&fvm_registers[MDR], sizeof(uint8_t), 1, disk); // Write the lowest byte to disk
 
                     return 0;
                 case 2: // For screen buffer:
-                    return fvmgl_update(&files[MEM].self[fvm_registers[MDR]]);
+                    return store_screen_buffer();
                 case 3: // For Keyboard:
+                    if(fvmgl_require())
+                        return 1;
+
                     fvmkbd_get_scancode_for_key();
 
                     return 0;
@@ -152,21 +255,24 @@ _Bool store(void) { // st <mdr> at <mar> in <mch>
                     return 0;
             }
         case CST: // For Callstack
-            if(fvm_registers[MAR] + 1 > files[CST].size) { // If MAR is an address not currently in the allocated memory's range
-                files[CST].size = fvm_registers[MAR] + 1;
+            if(quota_callstack(fvm_registers[MAR])) // Refuse to go past its limit
+                return 1;
 
-                if((alloc_buff = (void *)realloc(files[CST].self, files[CST].size * sizeof(uint64_t))) == NULL) { // Attempt to reallocate the callstack to accomodate it
-                    perror("fvmr -> Failure to reallocate memory for Callstack to perform write to custom address thereupon");
+            if(file_reserve(&files[CST], fvm_registers[MAR])) { // Attempt to grow the callstack to accomodate MAR if it's not currently in the allocated memory's range
+                perror("fvmr -> Failure to reallocate memory for Callstack to perform write to custom address thereupon");
 
-                    return 1;
-                }
-
-                files[CST].self = (uint64_t *)alloc_buff;
+                return 1;
             }
 
             files[CST].self[fvm_registers[MAR]] = fvm_registers[MDR]; // Write MDR to address MAR in CST
 
             return 0;
+        case ALC: // For the heap allocator:
+            return heap_store(); // Free the block at MAR
+        case BLK: // For bulk operations:
+            return bulk_store(); // Copy or fill the range at MDR
+        case BYT: // For Main Memory, a byte at a time:
+            return memory_store_byte(fvm_registers[MAR], fvm_registers[MDR]); // Store the lowest byte of MDR at byte address MAR
         default: // For an any other given Memory Channel:
             fprintf(stderr, "fvmr -> Attempted write to unknown MCH '%zu'\n", fvm_registers[MCH]);
 
@@ -179,32 +285,19 @@ _Bool load(void) { // ld to <mdr> from <mar> in <mch>
 
     switch(fvm_registers[MCH]) { // Load in a different way depending on MCH
         case MEM: // For Main Memory:
-            if(fvm_registers[MAR] + 1 > files[MEM].length) { // If the address to load from is outside the bounds currently allocated
-                files[MEM].length = fvm_registers[MAR] + 1; // Resize the memory known
-
-                if(files[MEM].length > files[MEM].size) { // If a reallocation needs to be done in accordance with the new size
-                    files[MEM].size = files[MEM].length;
-
-                    if((alloc_buff = (void *)realloc(files[MEM].self, files[MEM].size * sizeof(uint64_t))) == NULL) { // Attempt to reallocate Main Memory
-                        perror("fvmr -> Failure accessing memory at specified address");
-
-                        return 1;
-                    }
-
-                    files[MEM].self = (uint64_t *)alloc_buff;
-                }
-            }
-
-            fvm_registers[MDR] = files[MEM].self[fvm_registers[MAR]]; // Place the value from Main Memory at MAR into MDR
+            fvm_registers[MDR] = memory_load(fvm_registers[MAR]); // Place the value from Main Memory at MAR into MDR
 
             return 0;
         case INP: // For Input:
             switch(fvm_registers[MAR]) { // Depending on where to input from (indicated in MAR)
                 case 0: // For Standard I/O:
-                    fvm_registers[MDR] = fgetc(stdin); // Place a byte from stdin into MDR
+                    fvm_registers[MDR] = console_input != NULL ? fgetc(console_input) : EOF; // Place a byte from stdin into MDR
 
                     return 0;
                 case 1: // For Secondary Storage:
+                    if(disk == NULL)
+                        return missing_disk();
+
                     fvm_registers[MDR] = ftell(disk); // Set MDR to current offset from beginning of disk (in bytes)
 
                     return 0;
@@ -213,6 +306,9 @@ _Bool load(void) { // ld to <mdr> from <mar> in <mch>
 
                     return 1;
                 case 3: // For Keyboard:
+                    if(fvmgl_require())
+                        return 1;
+
                     fvmkbd_get_next_keypress_as_key();
 
                     return 0;
@@ -224,10 +320,13 @@ _Bool load(void) { // ld to <mdr> from <mar> in <mch>
         case OUT: // For Output:
             switch(fvm_registers[MAR]) { // Depending on MAR load from a different output source:
                 case 0: // For Standard I/O:
-                    fvm_registers[MDR] = fgetc(stdout); // Retrieve one byte from stdout into MDR
+                    fvm_registers[MDR] = console_output != NULL ? fgetc(console_output) : EOF; // Retrieve one byte from stdout into MDR
 
                     return 0;
                 case 1: // For Secondary Storage:
+                    if(disk == NULL)
+                        return missing_disk();
+
                     fread(&fvm_registers[MDR], sizeof(uint8_t), 1, disk); // Read one byte from the disk into MDR
 
                     return 0;
@@ -236,6 +335,9 @@ _Bool load(void) { // ld to <mdr> from <mar> in <mch>
 
                     return 1;
                 case 3: // For Keyboard
+                    if(fvmgl_require())
+                        return 1;
+
                     fvmkbd_get_keypress_queue_length();
 
                     return 0;
@@ -245,19 +347,15 @@ _Bool load(void) { // ld to <mdr> from <mar> in <mch>
                     return 0;
             }
         case CST: // For Callstack:
-            if(fvm_registers[MAR] + 1 > files[CST].size) { // If the address to read from is outside of the allocated size for the Callstack
-                files[CST].size = fvm_registers[MAR] + 1;
-
-                if((alloc_buff = (void *)realloc(files[CST].self, files[CST].size * sizeof(uint64_t))) == NULL) { // Try to reallocate the Callstack's memory to retrieve the address
-                    perror("fvmr -> Failure to reallocate memory for Callstack to perform read from custom address thereupon");
-
-                    return 1;
-                }
-
-                files[CST].self = (uint64_t *)alloc_buff;
-            }
+            fvm_registers[MDR] = fvm_registers[MAR] < files[CST].size ? files[CST].self[fvm_registers[MAR]] : 0; // Place the value at MAR on the Callstack into MDR, addresses outside of its allocated size reading as 0
 
-            fvm_registers[MDR] = files[CST].self[fvm_registers[MAR]]; // Place the value at MAR on the Callstack into MDR
+            return 0;
+        case ALC: // For the heap allocator:
+            return heap_load(); // Reallocate the block at MAR (or allocate one, if it's 0) to MDR cells, with its address in MDR
+        case BLK: // For bulk operations:
+            return bulk_load(); // Compare or search the range at MDR, with the result in MDR
+        case BYT: // For Main Memory, a byte at a time:
+            fvm_registers[MDR] = memory_load_byte(fvm_registers[MAR]); // Place the byte at byte address MAR into MDR
 
             return 0;
         default: // For an unrecognised MCH:
@@ -414,17 +512,8 @@ _Bool accumulator_ne(void) { // ne
 }
 
 _Bool call_address(void) { // cl
-    if(++files[CST].length > files[CST].size) { // If the callstack needs reallocating to include the address of this call
-        files[CST].size += ALLOC_SIZE;
-
-        if((alloc_buff = (void *)realloc(files[CST].self, files[CST].size * sizeof(uint64_t))) == NULL) { // Try to allocate it more space
-            perror("fvmr -> Failure reallocating memory for Callstack");
-
-            return 1;
-        }
-
-        files[CST].self = (uint64_t *)alloc_buff;
-    }
+    if(quota_push()) // Try to grow the callstack if it needs to include the address of this call
+        return 1;
 
     fvm_registers[CSP] = files[CST].length - 1; // Set CSP to new value
 
@@ -8,11 +8,36 @@
 #include "global.h"
 #include "fvmgl.h"
 #include "fvmkbd.h"
+#include "decoder.h"
+#include "block.h"
+#include "service.h"
+#include "paged.h"
+#include "quota.h"
+#include "heap.h"
+#include "bulk.h"
 
 extern _Bool (*instructions[NO_INSTRUCTIONS])(void); // Array of function-pointers for each instruction
 
+extern void table_run(void); // Execute from CEA (0 at boot, or wherever a translated ROM handed over) by dispatching through instructions[] until fi or an error, setting fvmr_exit_code
+
 extern _Bool place(void); // pl <value> <register>
 extern _Bool move(void); // mv <register> <register>
+extern _Bool memory_store(uint64_t address, uint64_t value); // Write value to address in Main Memory as st does, growing it or paging it as needed and keeping what was decoded from it in step. Returns 1 (having reported why) on failure
+static inline uint64_t memory_load(uint64_t address) { // Value at address in Main Memory as ld reads it, looking past its end in paged memory (where addresses that were never written to read as 0)
+    return address < files[MEM].length ? files[MEM].self[address] : paged_load(&paged, address);
+}
+
+// MCH BYT addresses Main Memory a byte at a time, so that text and binary data can be packed 8 bytes to a cell: byte
+// address a is byte a & 7 of the cell at address a >> 3, counting up from its least significant byte, which is the order
+// in which fvma packs []p literals. ld on BYT reads the byte into MDR, and st writes the lowest byte of MDR.
+
+static inline uint64_t memory_load_byte(uint64_t address) { // Byte at byte address in Main Memory, as ld on BYT reads it
+    return memory_load(address >> 3) >> (address & 7) * 8 & 0xFF;
+}
+
+extern _Bool memory_store_byte(uint64_t address, uint8_t value); // Write value to byte address in Main Memory as st on BYT does, leaving the rest of its cell as it was. Returns 1 (having reported why) on failure
+extern void memory_invalidate(uint64_t from, uint64_t to); // Forget any decoded instructions and blocks covering the cells from from up to (not including) to, after they were written to directly rather than through memory_store()
+extern _Bool store_screen_buffer(void); // st to MAR 2 on INP or OUT: pass the command at MDR to fvmgl
 extern _Bool store(void); // st <mdr> at <mar> in <mch>
 extern _Bool load(void); // ld to <mdr> from <mar> in <mch>
 extern _Bool jump(void); // jm <address>
@@ -0,0 +1,665 @@
+/* Fox Virtual Machine: Template JIT
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// The jit engine is the block engine (see block.c), with blocks that have been entered JIT_THRESHOLD times translated
+// into x86-64 code. Each instruction is translated from a fixed template, with ACC, DAT, MCH, MAR and MDR pinned to host
+// registers for the length of the block, and the other registers left in fvm_registers. st and ld on Main Memory are
+// done inline, and anything else (other channels, Main Memory having to grow, or a store below decoder.extent, where it
+// could hit code) goes through store() and load() as usual.
+//
+// A translation covers a block up to its terminator, or up to the first instruction that isn't translated (cl, rt, fi,
+// mv into CEA), where it hands the rest of the block to the interpreter. A store that invalidates the running block ends
+// the translation straight after it, and the block is rebuilt, and interpreted until it's hot again, the next time it's
+// reached. Fused ops run natively aren't counted in decoder.fused.
+
+#include "jit.h"
+#include "instructions.h"
+
+struct fvmr_jit jit = {
+    .code = NULL,
+    .used = 0,
+    .translated = 0,
+    .bytes = 0,
+    .flushes = 0,
+    .current = NULL,
+    .perf_map = NULL
+};
+
+#if defined(__x86_64__) && !defined(FVMR_NO_JIT)
+
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+enum jit_host_register { // x86-64 general purpose registers, by encoding
+    JIT_RAX = 0, JIT_RCX = 1, JIT_RDX = 2, JIT_RBX = 3, JIT_RSP = 4, JIT_RBP = 5, JIT_RSI = 6, JIT_RDI = 7,
+    JIT_R8 = 8, JIT_R9 = 9, JIT_R10 = 10, JIT_R11 = 11, JIT_R12 = 12, JIT_R13 = 13, JIT_R14 = 14, JIT_R15 = 15
+};
+
+enum jit_condition { // Second opcode byte of jcc rel32
+    JIT_JB = 0x82,
+    JIT_JAE = 0x83,
+    JIT_JE = 0x84,
+    JIT_JNE = 0x85
+};
+
+enum jit_helper_result { // What the helpers called from translations return
+    JIT_HELPER_OK = 0,
+    JIT_HELPER_ERROR = 1, // store() or load() failed
+    JIT_HELPER_LEFT = 2 // The store (or a load from the heap allocator) invalidated the running block
+};
+
+#define JIT_ACC JIT_RBX // Host registers that registers are pinned to, all of them callee-saved so that helpers keep them
+#define JIT_DAT JIT_RBP
+#define JIT_MAR JIT_R12
+#define JIT_MDR JIT_R13
+#define JIT_MCH JIT_R14
+#define JIT_REGISTERS JIT_R15 // Holds &fvm_registers[0]
+
+static const int8_t JIT_PINNED[NO_REGISTERS] = { // Host register that each register is held in, or -1 if it's left in fvm_registers
+    [MCH] = JIT_MCH,
+    [MAR] = JIT_MAR,
+    [MDR] = JIT_MDR,
+    [ACC] = JIT_ACC,
+    [DAT] = JIT_DAT,
+    [CEA] = -1,
+    [CSP] = -1,
+    [GP0] = -1, [GP1] = -1, [GP2] = -1, [GP3] = -1, [GP4] = -1, [GP5] = -1, [GP6] = -1, [GP7] = -1
+};
+
+static const uint8_t JIT_SETCC[6] = { // Second opcode byte of setcc for gt, lt, ge, le, eq and ne (unsigned, like the interpreter)
+    0x97, // seta
+    0x92, // setb
+    0x93, // setae
+    0x96, // setbe
+    0x94, // sete
+    0x95 // setne
+};
+
+static uint8_t *emit; // Where the next byte of code goes
+
+static void jit_byte(uint8_t byte) {
+    *emit++ = byte;
+}
+
+static void jit_u32(uint32_t value) {
+    memcpy(emit, &value, sizeof(value));
+    emit += sizeof(value);
+}
+
+static void jit_u64(uint64_t value) {
+    memcpy(emit, &value, sizeof(value));
+    emit += sizeof(value);
+}
+
+static void jit_rex(int reg, int index, int base) { // REX.W prefix with the high bits of each operand
+    jit_byte(0x48 | (reg >> 3) << 2 | (index >> 3) << 1 | base >> 3);
+}
+
+static void jit_op_rr(uint8_t opcode, int reg, int rm) { // <op> rm, reg (or reg, rm, depending on the opcode)
+    jit_rex(reg, 0, rm);
+    jit_byte(opcode);
+    jit_byte(0xC0 | (reg & 7) << 3 | (rm & 7));
+}
+
+static void jit_op_rm(uint8_t opcode, int reg, int base, int32_t displacement) { // <op> with a [base + displacement] operand
+    jit_rex(reg, 0, base);
+    jit_byte(opcode);
+    jit_byte(0x80 | (reg & 7) << 3 | (base & 7));
+
+    if((base & 7) == JIT_RSP) // rsp and r12 as a base need a SIB byte
+        jit_byte(0x24);
+
+    jit_u32(displacement);
+}
+
+static void jit_op_indexed(uint8_t opcode, int reg, int base, int index) { // <op> with a [base + index * 8] operand (base can't be rbp or r13)
+    jit_rex(reg, index, base);
+    jit_byte(opcode);
+    jit_byte(0x04 | (reg & 7) << 3);
+    jit_byte(0xC0 | (index & 7) << 3 | (base & 7));
+}
+
+static void jit_op_unary(uint8_t opcode, uint8_t extension, int rm) { // <op> rm, with the opcode extension in the reg field
+    jit_rex(0, 0, rm);
+    jit_byte(opcode);
+    jit_byte(0xC0 | extension << 3 | (rm & 7));
+}
+
+static void jit_mov_imm(int reg, uint64_t value) { // mov reg, value
+    if(value <= UINT32_MAX) { // mov r32, imm32 zero-extends
+        if(reg >= 8)
+            jit_byte(0x41);
+
+        jit_byte(0xB8 + (reg & 7));
+        jit_u32(value);
+    } else {
+        jit_byte(0x48 | reg >> 3);
+        jit_byte(0xB8 + (reg & 7));
+        jit_u64(value);
+    }
+}
+
+static void jit_push(int reg) {
+    if(reg >= 8)
+        jit_byte(0x41);
+
+    jit_byte(0x50 + (reg & 7));
+}
+
+static void jit_pop(int reg) {
+    if(reg >= 8)
+        jit_byte(0x41);
+
+    jit_byte(0x58 + (reg & 7));
+}
+
+static uint8_t *jit_jump(uint8_t condition) { // jcc rel32 (or jmp rel32 if condition is 0) to somewhere not known yet, returns where to patch it
+    if(condition) {
+        jit_byte(0x0F);
+        jit_byte(condition);
+    } else {
+        jit_byte(0xE9);
+    }
+
+    jit_u32(0);
+
+    return emit - 4;
+}
+
+static void jit_land(uint8_t *patch) { // Point the jump at patch to here
+    int32_t offset = emit - (patch + 4);
+
+    memcpy(patch, &offset, sizeof(offset));
+}
+
+static int jit_source(uint64_t reg, int scratch, uint64_t cea) { // Get a register into a host register, returning which one
+    if(reg == CEA) { // Only a mv reads CEA, and it's on the mv's own address
+        jit_mov_imm(scratch, cea);
+
+        return scratch;
+    }
+
+    if(JIT_PINNED[reg] >= 0)
+        return JIT_PINNED[reg];
+
+    jit_op_rm(0x8B, scratch, JIT_REGISTERS, reg * sizeof(uint64_t));
+
+    return scratch;
+}
+
+static void jit_set(uint64_t reg, int host) { // Write a register (anything but CEA) from a host register
+    if(JIT_PINNED[reg] < 0)
+        jit_op_rm(0x89, host, JIT_REGISTERS, reg * sizeof(uint64_t));
+    else if(JIT_PINNED[reg] != host)
+        jit_op_rr(0x89, host, JIT_PINNED[reg]);
+}
+
+static void jit_write_back(uint64_t reg) { // Write a pinned register back to fvm_registers
+    jit_op_rm(0x89, JIT_PINNED[reg], JIT_REGISTERS, reg * sizeof(uint64_t));
+}
+
+static void jit_read_back(uint64_t reg) { // Reload a pinned register from fvm_registers
+    jit_op_rm(0x8B, JIT_PINNED[reg], JIT_REGISTERS, reg * sizeof(uint64_t));
+}
+
+static void jit_exit(enum jit_exit_kind kind, uint64_t resume, uint64_t cea, uint64_t executed) { // Write everything back and return from the translation
+    jit_write_back(MCH);
+    jit_write_back(MAR);
+    jit_write_back(MDR);
+    jit_write_back(ACC);
+    jit_write_back(DAT);
+
+    jit_mov_imm(JIT_RAX, cea);
+    jit_op_rm(0x89, JIT_RAX, JIT_REGISTERS, CEA * sizeof(uint64_t));
+
+    jit_mov_imm(JIT_RAX, (uint64_t)kind | resume << 32); // struct jit_exit comes back in rax:rdx
+    jit_mov_imm(JIT_RDX, executed);
+
+    jit_byte(0x48); // add rsp, 8
+    jit_byte(0x83);
+    jit_byte(0xC4);
+    jit_byte(0x08);
+
+    jit_pop(JIT_R15);
+    jit_pop(JIT_R14);
+    jit_pop(JIT_R13);
+    jit_pop(JIT_R12);
+    jit_pop(JIT_RBP);
+    jit_pop(JIT_RBX);
+
+    jit_byte(0xC3); // ret
+}
+
+static enum jit_helper_result jit_helper_store(void) { // st for anything that isn't done inline
+    if(store())
+        return JIT_HELPER_ERROR;
+
+    return jit.current->valid ? JIT_HELPER_OK : JIT_HELPER_LEFT;
+}
+
+static enum jit_helper_result jit_helper_load(void) { // ld for anything that isn't done inline
+    if(load())
+        return JIT_HELPER_ERROR;
+
+    return jit.current->valid ? JIT_HELPER_OK : JIT_HELPER_LEFT; // (The heap allocator writes to Main Memory)
+}
+
+static void jit_call(enum jit_helper_result (*helper)(void)) { // Call a helper that works on the channel registers in fvm_registers
+    jit_write_back(MCH);
+    jit_write_back(MAR);
+    jit_write_back(MDR);
+
+    jit_mov_imm(JIT_RAX, (uint64_t)(uintptr_t)helper);
+
+    jit_byte(0xFF); // call rax
+    jit_byte(0xD0);
+
+    jit_read_back(MCH);
+    jit_read_back(MAR);
+    jit_read_back(MDR);
+}
+
+static void jit_memory_access(_Bool storing, uint64_t cea, uint64_t executed) { // st or ld, with cea on its cell and executed counting everything before it
+    uint8_t *not_memory, *outside, *code = NULL, *done, *helped, *left;
+
+    jit_op_rr(0x85, JIT_MCH, JIT_MCH); // test mch, mch
+
+    not_memory = jit_jump(JIT_JNE);
+
+    jit_mov_imm(JIT_RAX, (uint64_t)(uintptr_t)&files[MEM]);
+    jit_op_rm(0x3B, JIT_MAR, JIT_RAX, offsetof(struct fvm_file, length)); // cmp mar, [length]
+
+    outside = jit_jump(JIT_JAE);
+
+    if(storing) { // Stores to anywhere that's been decoded go through store(), to invalidate whatever's there
+        jit_mov_imm(JIT_RCX, (uint64_t)(uintptr_t)&decoder.extent);
+        jit_op_rm(0x3B, JIT_MAR, JIT_RCX, 0); // cmp mar, [extent]
+
+        code = jit_jump(JIT_JB);
+    }
+
+    jit_op_rm(0x8B, JIT_RAX, JIT_RAX, offsetof(struct fvm_file, self)); // mov rax, [self]
+    jit_op_indexed(storing ? 0x89 : 0x8B, JIT_MDR, JIT_RAX, JIT_MAR); // mov [rax + mar * 8], mdr (or the other way round)
+
+    done = jit_jump(0);
+
+    jit_land(not_memory);
+    jit_land(outside);
+
+    if(storing)
+        jit_land(code);
+
+    jit_call(storing ? jit_helper_store : jit_helper_load);
+
+    jit_byte(0x85); // test eax, eax
+    jit_byte(0xC0);
+
+    helped = jit_jump(JIT_JE);
+
+    jit_byte(0x83); // cmp eax, JIT_HELPER_ERROR
+    jit_byte(0xF8);
+    jit_byte(JIT_HELPER_ERROR);
+
+    left = jit_jump(JIT_JNE);
+
+    jit_exit(JIT_EXIT_ERROR, 0, cea, executed);
+
+    jit_land(left); // Either helper can invalidate the running block (a load by reallocating on the heap)
+    jit_exit(JIT_EXIT_LEAVE, 0, cea + 1, executed + 1);
+
+    jit_land(done);
+    jit_land(helped);
+}
+
+static void jit_branch(_Bool if_set, uint64_t target, uint64_t next, uint64_t executed) { // The end of js or jc, with executed counting it
+    uint8_t *not_taken;
+
+    jit_op_rr(0x85, JIT_ACC, JIT_ACC); // test acc, acc
+
+    not_taken = jit_jump(if_set ? JIT_JE : JIT_JNE);
+
+    jit_exit(JIT_EXIT_TAKEN, 0, target, executed);
+    jit_land(not_taken);
+    jit_exit(JIT_EXIT_NOT_TAKEN, 0, next, executed);
+}
+
+static void jit_compare(uint16_t op) { // gt, lt, ge, le, eq or ne, given as DECODED_ACCUMULATOR_GT onwards
+    jit_op_rr(0x39, JIT_DAT, JIT_ACC); // cmp acc, dat
+
+    jit_byte(0x0F); // setcc al
+    jit_byte(JIT_SETCC[op - DECODED_ACCUMULATOR_GT]);
+    jit_byte(0xC0);
+
+    jit_rex(JIT_ACC, 0, JIT_RAX); // movzx acc, al
+    jit_byte(0x0F);
+    jit_byte(0xB6);
+    jit_byte(0xC0 | (JIT_ACC & 7) << 3 | JIT_RAX);
+}
+
+static void jit_arithmetic(uint16_t op) { // One of the ALU operations on acc and dat
+    switch(op) {
+        case DECODED_ACCUMULATOR_ADD:
+            jit_op_rr(0x01, JIT_DAT, JIT_ACC);
+            break;
+        case DECODED_ACCUMULATOR_SUB:
+            jit_op_rr(0x29, JIT_DAT, JIT_ACC);
+            break;
+        case DECODED_ACCUMULATOR_NOT:
+            jit_op_unary(0xF7, 2, JIT_ACC);
+            break;
+        case DECODED_ACCUMULATOR_INCREMENT:
+            jit_op_unary(0xFF, 0, JIT_ACC);
+            break;
+        case DECODED_ACCUMULATOR_DECREMENT:
+            jit_op_unary(0xFF, 1, JIT_ACC);
+            break;
+        case DECODED_ACCUMULATOR_MUL: // imul acc, dat (the low half is the same signed or not)
+            jit_rex(JIT_ACC, 0, JIT_DAT);
+            jit_byte(0x0F);
+            jit_byte(0xAF);
+            jit_byte(0xC0 | (JIT_ACC & 7) << 3 | (JIT_DAT & 7));
+            break;
+        case DECODED_ACCUMULATOR_DIV: // Division by zero traps, the same as it does in the interpreter
+            jit_op_rr(0x89, JIT_ACC, JIT_RAX);
+
+            jit_byte(0x31); // xor edx, edx
+            jit_byte(0xD2);
+
+            jit_op_unary(0xF7, 6, JIT_DAT);
+            jit_op_rr(0x89, JIT_RAX, JIT_ACC);
+            break;
+        case DECODED_ACCUMULATOR_AND:
+            jit_op_rr(0x21, JIT_DAT, JIT_ACC);
+            break;
+        case DECODED_ACCUMULATOR_OR:
+            jit_op_rr(0x09, JIT_DAT, JIT_ACC);
+            break;
+        case DECODED_ACCUMULATOR_XOR:
+            jit_op_rr(0x31, JIT_DAT, JIT_ACC);
+            break;
+        case DECODED_ACCUMULATOR_LSH:
+        case DECODED_ACCUMULATOR_RSH:
+            jit_op_rr(0x89, JIT_DAT, JIT_RCX);
+            jit_op_unary(0xD3, op == DECODED_ACCUMULATOR_LSH ? 4 : 5, JIT_ACC);
+            break;
+        default:
+            jit_compare(op);
+    }
+}
+
+static void jit_flush(void) { // Throw every translation away, to start filling the code from the beginning again
+    for(uint64_t i = 0; i < blocks.length; i++) {
+        if(blocks.table[i] != NULL) {
+            blocks.table[i]->native = NULL;
+            blocks.table[i]->heat = 0;
+        }
+    }
+
+    jit.used = 0;
+    jit.flushes++;
+}
+
+_Bool jit_init(_Bool perf_map) { // Map memory for translations
+    char path[64];
+
+    if((jit.code = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED) {
+        perror("fvmr -> Could not map memory for native code, so blocks won't be translated");
+
+        jit.code = NULL;
+
+        return 1;
+    }
+
+    if(perf_map) { // Let perf attribute samples in translations to the blocks they came from
+        snprintf(path, sizeof(path), "/tmp/perf-%d.map", (int)getpid());
+
+        if((jit.perf_map = fopen(path, "w")) == NULL)
+            perror("fvmr -> Could not open perf map");
+    }
+
+    return 0;
+}
+
+_Bool jit_compile(struct fvmr_block *block) { // Translate block into native code
+    struct decoded_instruction *slot;
+    uint64_t address = block->start,
+             executed = 0, // Instructions before the one being translated
+             next,
+             reg;
+    uint8_t *start;
+    int host;
+
+    switch(block->code[0].op) { // Nothing to gain from a translation that hands straight back to the interpreter
+        case DECODED_CALL:
+        case DECODED_RETURN:
+        case DECODED_FINISH:
+            return 1;
+        case DECODED_MOVE_ANY:
+            if(block->code[0].reg[1] == CEA)
+                return 1;
+    }
+
+    if(JIT_CODE_SIZE - jit.used < JIT_MAX_BLOCK_SIZE)
+        jit_flush();
+
+    start = emit = jit.code + jit.used;
+
+    jit_push(JIT_RBX); // Prologue: save the callee-saved registers that are about to be pinned, keeping the stack aligned for helpers
+    jit_push(JIT_RBP);
+    jit_push(JIT_R12);
+    jit_push(JIT_R13);
+    jit_push(JIT_R14);
+    jit_push(JIT_R15);
+
+    jit_byte(0x48); // sub rsp, 8
+    jit_byte(0x83);
+    jit_byte(0xEC);
+    jit_byte(0x08);
+
+    jit_mov_imm(JIT_REGISTERS, (uint64_t)(uintptr_t)fvm_registers);
+
+    jit_read_back(MCH);
+    jit_read_back(MAR);
+    jit_read_back(MDR);
+    jit_read_back(ACC);
+    jit_read_back(DAT);
+
+    for(uint64_t i = 0;; i++) {
+        slot = &block->code[i];
+
+        if(slot->op == BLOCK_CONTINUE) { // A block that was cut short carries on at the next address
+            jit_exit(JIT_EXIT_NOT_TAKEN, 0, address, executed);
+
+            break;
+        }
+
+        next = address + slot->length;
+
+        switch(slot->op) {
+            case DECODED_PLACE: // pl <value> <register>
+                if(JIT_PINNED[slot->reg[0]] >= 0) {
+                    jit_mov_imm(JIT_PINNED[slot->reg[0]], slot->operand);
+                } else {
+                    jit_mov_imm(JIT_RAX, slot->operand);
+                    jit_set(slot->reg[0], JIT_RAX);
+                }
+
+                break;
+            case DECODED_PLACE_ACC: // pl <value> acc
+                jit_mov_imm(JIT_ACC, slot->operand);
+                break;
+            case DECODED_PLACE_DAT: // pl <value> dat
+                jit_mov_imm(JIT_DAT, slot->operand);
+                break;
+            case DECODED_PLACE_CEA: // pl <value> cea
+                jit_exit(JIT_EXIT_TAKEN, 0, slot->operand + 3, executed + 1);
+                goto translated;
+            case DECODED_MOVE_ANY: // mv <register> <register>, where either can be held in a local
+                if(slot->reg[1] == CEA) { // Where this goes is left to the interpreter
+                    jit_exit(JIT_EXIT_INTERPRET, i, address, executed);
+                    goto translated;
+                }
+                // Fall through
+            case DECODED_MOVE: // mv <register> <register>
+            case DECODED_MOVE_TO_ACC: // mv <register> acc
+            case DECODED_MOVE_FROM_ACC: // mv acc <register>
+                reg = slot->reg[1];
+                host = jit_source(slot->reg[0], JIT_PINNED[reg] >= 0 ? JIT_PINNED[reg] : JIT_RAX, address);
+
+                jit_set(reg, host);
+                break;
+            case DECODED_STORE: // st, quickened or not
+            case DECODED_STORE_MEM:
+            case DECODED_STORE_CST:
+            case DECODED_STORE_OUT_STDIO:
+            case DECODED_STORE_OUT_DISK:
+                jit_memory_access(1, address, executed);
+                break;
+            case DECODED_LOAD: // ld, quickened or not
+            case DECODED_LOAD_MEM:
+            case DECODED_LOAD_CST:
+            case DECODED_LOAD_INP_STDIO:
+            case DECODED_LOAD_OUT_DISK:
+                jit_memory_access(0, address, executed);
+                break;
+            case DECODED_JUMP: // jm <address>
+                jit_exit(JIT_EXIT_TAKEN, 0, slot->operand, executed + 1);
+                goto translated;
+            case DECODED_JUMP_IF_SET: // js <address>
+            case DECODED_JUMP_IF_CLEAR: // jc <address>
+                jit_branch(slot->op == DECODED_JUMP_IF_SET, slot->operand, next, executed + 1);
+                goto translated;
+            case DECODED_ACCUMULATOR_ADD: // The ALU operations
+            case DECODED_ACCUMULATOR_SUB:
+            case DECODED_ACCUMULATOR_NOT:
+            case DECODED_ACCUMULATOR_INCREMENT:
+            case DECODED_ACCUMULATOR_DECREMENT:
+            case DECODED_ACCUMULATOR_MUL:
+            case DECODED_ACCUMULATOR_DIV:
+            case DECODED_ACCUMULATOR_AND:
+            case DECODED_ACCUMULATOR_OR:
+            case DECODED_ACCUMULATOR_XOR:
+            case DECODED_ACCUMULATOR_LSH:
+            case DECODED_ACCUMULATOR_RSH:
+            case DECODED_ACCUMULATOR_GT:
+            case DECODED_ACCUMULATOR_LT:
+            case DECODED_ACCUMULATOR_GE:
+            case DECODED_ACCUMULATOR_LE:
+            case DECODED_ACCUMULATOR_EQ:
+            case DECODED_ACCUMULATOR_NE:
+                jit_arithmetic(slot->op);
+                break;
+            case DECODED_PLACE_DAT_ADD: // pl <value> dat; a+, a- or a*
+                jit_mov_imm(JIT_DAT, slot->operand);
+                jit_arithmetic(DECODED_ACCUMULATOR_ADD);
+                break;
+            case DECODED_PLACE_DAT_SUB:
+                jit_mov_imm(JIT_DAT, slot->operand);
+                jit_arithmetic(DECODED_ACCUMULATOR_SUB);
+                break;
+            case DECODED_PLACE_DAT_MUL:
+                jit_mov_imm(JIT_DAT, slot->operand);
+                jit_arithmetic(DECODED_ACCUMULATOR_MUL);
+                break;
+            case DECODED_GT_JUMP_IF_SET: // A compare, followed by js or jc
+            case DECODED_GT_JUMP_IF_CLEAR:
+            case DECODED_LT_JUMP_IF_SET:
+            case DECODED_LT_JUMP_IF_CLEAR:
+            case DECODED_GE_JUMP_IF_SET:
+            case DECODED_GE_JUMP_IF_CLEAR:
+            case DECODED_LE_JUMP_IF_SET:
+            case DECODED_LE_JUMP_IF_CLEAR:
+            case DECODED_EQ_JUMP_IF_SET:
+            case DECODED_EQ_JUMP_IF_CLEAR:
+            case DECODED_NE_JUMP_IF_SET:
+            case DECODED_NE_JUMP_IF_CLEAR:
+                jit_compare(DECODED_ACCUMULATOR_GT + (slot->op - DECODED_GT_JUMP_IF_SET) / 2);
+                jit_branch(!((slot->op - DECODED_GT_JUMP_IF_SET) & 1), slot->operand, next, executed + 2);
+                goto translated;
+            case DECODED_PLACE_MCH_STORE: // pl <value> mch/mar/mdr, followed by st or ld, where the second half has its own cell
+            case DECODED_PLACE_MCH_LOAD:
+            case DECODED_PLACE_MAR_STORE:
+            case DECODED_PLACE_MAR_LOAD:
+            case DECODED_PLACE_MDR_STORE:
+                reg = slot->op == DECODED_PLACE_MCH_STORE || slot->op == DECODED_PLACE_MCH_LOAD ? MCH :
+                      slot->op == DECODED_PLACE_MAR_STORE || slot->op == DECODED_PLACE_MAR_LOAD ? MAR :
+                      MDR;
+
+                jit_mov_imm(JIT_PINNED[reg], slot->operand);
+                jit_memory_access(slot->op != DECODED_PLACE_MCH_LOAD && slot->op != DECODED_PLACE_MAR_LOAD, address + 3, executed + 1);
+                break;
+            default: // cl, rt and fi are left to the interpreter
+                jit_exit(JIT_EXIT_INTERPRET, i, address, executed);
+                goto translated;
+        }
+
+        executed += slot->op >= DECODED_FIRST_FUSED ? 2 : 1;
+        address = next;
+    }
+
+translated:
+    block->native = (struct jit_exit (*)(void))(void *)start;
+
+    jit.used = (emit - jit.code + 15) & ~(uint64_t)15; // Keep translations aligned
+    jit.bytes += emit - start;
+    jit.translated++;
+
+    if(jit.perf_map != NULL) {
+        fprintf(jit.perf_map, "%zx %zx fvm_block_%zu\n", (uint64_t)(uintptr_t)start, (uint64_t)(emit - start), block->start);
+        fflush(jit.perf_map);
+    }
+
+    return 0;
+}
+
+void jit_end(void) { // Cleanup
+    if(jit.code != NULL)
+        munmap(jit.code, JIT_CODE_SIZE);
+
+    if(jit.perf_map != NULL)
+        fclose(jit.perf_map);
+
+    jit.code = NULL;
+    jit.perf_map = NULL;
+}
+
+#else // Hosts that translations can't be generated for run the block engine on its own
+
+_Bool jit_init(_Bool perf_map) {
+    (void)perf_map;
+
+    fprintf(stderr, "fvmr -> Native code isn't supported on this host, so blocks won't be translated\n");
+
+    return 1;
+}
+
+_Bool jit_compile(struct fvmr_block *block) {
+    (void)block;
+
+    return 1;
+}
+
+void jit_end(void) {
+}
+
+#endif
+
+void jit_report(void) { // Print how many blocks were translated
+    if(jit.code == NULL)
+        return;
+
+    fprintf(stderr,
+            "\tBlocks translated: %zu\n"
+            "\tNative code written: %zu bytes\n"
+            "\tNative code flushes: %zu\n",
+            jit.translated,
+            jit.bytes,
+            jit.flushes);
+}
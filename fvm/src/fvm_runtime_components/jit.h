@@ -0,0 +1,42 @@
+#ifndef FVMR_JIT_H
+
+#define FVMR_JIT_H
+
+#include "global.h"
+#include "decoder.h"
+#include "block.h"
+
+#define JIT_THRESHOLD 16 // Times a block has to be entered before it's translated
+#define JIT_CODE_SIZE (16 << 20) // Bytes of executable memory for translations, which is flushed when it fills up
+#define JIT_MAX_BLOCK_SIZE (64 << 10) // Most bytes that the translation of one block can take up
+
+enum jit_exit_kind { // How a translation left its block
+    JIT_EXIT_NOT_TAKEN = BLOCK_LINK_NOT_TAKEN, // Fell through to the block at CEA
+    JIT_EXIT_TAKEN = BLOCK_LINK_TAKEN, // Jumped to the block at CEA
+    JIT_EXIT_INTERPRET, // Reached an instruction that isn't translated, which the interpreter runs from resume
+    JIT_EXIT_LEAVE, // A store invalidated the block, so execution carries on at CEA without following a link
+    JIT_EXIT_ERROR // An instruction failed, with CEA on it
+};
+
+struct jit_exit { // What a translation returns, in registers
+    uint32_t kind, // enum jit_exit_kind
+             resume; // For JIT_EXIT_INTERPRET: index in block->code to carry on from
+    uint64_t executed; // Number of instructions run natively
+};
+
+extern struct fvmr_jit { // The translation cache
+    uint8_t *code; // Executable memory that translations are written to (NULL if the engine in use doesn't translate)
+    uint64_t used, // Bytes of code written since the last flush
+             translated, // Number of blocks translated
+             bytes, // Bytes of code written in total
+             flushes; // Number of times the code was thrown away to make room
+    struct fvmr_block *current; // The block whose translation is running, so that stores can tell if they hit it
+    FILE *perf_map; // /tmp/perf-<pid>.map, if --perf-map was given
+} jit;
+
+extern _Bool jit_init(_Bool perf_map); // Map memory for translations, after block_init(). Returns 1 (having reported why) if the host can't run them, in which case the block engine runs alone
+extern _Bool jit_compile(struct fvmr_block *block); // Translate block into native code, returns 1 if it starts with something that isn't translated
+extern void jit_report(void); // Print how many blocks were translated
+extern void jit_end(void); // Cleanup
+
+#endif
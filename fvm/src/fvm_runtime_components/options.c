@@ -0,0 +1,260 @@
+/* Fox Virtual Machine: Runtime Options
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "options.h"
+#include "cache.h"
+#include "scheduler.h"
+#include "checkpoint.h"
+#include "fvmgl.h"
+
+const char *ENGINE_NAMES[] = {
+    [FVMR_ENGINE_TABLE] = "table",
+    [FVMR_ENGINE_THREADED] = "threaded",
+    [FVMR_ENGINE_BLOCK] = "block",
+    [FVMR_ENGINE_JIT] = "jit",
+    [FVMR_ENGINE_PINNED] = "pinned"
+};
+
+struct fvmr_options fvmr_options = {
+    .engine = FVMR_ENGINE_TABLE, // Until the decoded engines are known to run every ROM that it does
+    .huge_pages = FVMR_HUGE_PAGES_NONE,
+    .stats = 0,
+    .fusion = 1,
+    .quickening = 1,
+    .perf_map = 0,
+    .cache = NULL,
+    .batch = NULL,
+    .fork_server = NULL,
+    .workers = 0,
+    .quantum = SCHEDULER_QUANTUM,
+    .snapshot_after = UINT64_MAX,
+    .snapshot_at = UINT64_MAX,
+    .checkpoint = NULL,
+    .resume = NULL,
+    .keyboard = NULL,
+    .rom = FVM_ROM,
+    .checkpoint_every = 0,
+    .max_instructions = UINT64_MAX,
+    .poll_every = FVMGL_POLL_EVERY,
+    .poll_interval = 0,
+    .max_memory = UINT64_MAX,
+    .max_callstack = UINT64_MAX,
+    .max_seconds = 0
+};
+
+static _Bool options_parse_engine(const char *name) { // Set the engine from its name, returns 1 if there is no engine by that name
+    for(size_t i = 0; i < sizeof(ENGINE_NAMES) / sizeof(ENGINE_NAMES[0]); i++) {
+        if(!strcmp(ENGINE_NAMES[i], name)) {
+            fvmr_options.engine = (enum fvmr_engine)i;
+
+            return 0;
+        }
+    }
+
+    fprintf(stderr, "fvmr -> Unknown engine '%s'\n", name);
+
+    return 1;
+}
+
+static _Bool options_parse_count(const char *option, const char *text, uint64_t *count) { // Read a positive count given to option, returns 1 if it isn't one
+    char *end;
+
+    *count = strtoull(text, &end, 10);
+
+    if(*text < '0' || *text > '9' || *end != '\0' || !*count) {
+        fprintf(stderr, "fvmr -> Expected a positive number for %s, not '%s'\n", option, text);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+static _Bool options_parse_seconds(const char *option, const char *text, double *seconds) { // Read a positive number of seconds given to option, returns 1 if it isn't one
+    char *end;
+
+    *seconds = strtod(text, &end);
+
+    if(*text < '0' || *text > '9' || *end != '\0' || !(*seconds > 0)) {
+        fprintf(stderr, "fvmr -> Expected a positive number of seconds for %s, not '%s'\n", option, text);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+static _Bool options_parse_poll(const char *policy) { // Set when window events are polled for from "io", "<instructions>" or "<milliseconds>ms", returns 1 if it's none of them
+    char *end;
+    uint64_t count;
+
+    if(!strcmp(policy, "io")) { // Only at the guest's graphics and keyboard operations
+        fvmr_options.poll_every = UINT64_MAX;
+        fvmr_options.poll_interval = 0;
+
+        return 0;
+    }
+
+    count = strtoull(policy, &end, 10);
+
+    if(*policy >= '0' && *policy <= '9' && count && (!*end || !strcmp(end, "ms"))) {
+        fvmr_options.poll_every = *end ? UINT64_MAX : count;
+        fvmr_options.poll_interval = *end ? count : 0;
+
+        return 0;
+    }
+
+    fprintf(stderr, "fvmr -> Expected 'io', a positive number of instructions, or a positive number of milliseconds followed by 'ms' for --poll, not '%s'\n", policy);
+
+    return 1;
+}
+
+static _Bool options_parse_huge_pages(const char *backing) { // Set how Main Memory is backed with huge pages, returns 1 if backing isn't one of the ways
+    if(!strcmp(backing, "transparent")) {
+        fvmr_options.huge_pages = FVMR_HUGE_PAGES_TRANSPARENT;
+    } else if(!strcmp(backing, "explicit")) {
+        fvmr_options.huge_pages = FVMR_HUGE_PAGES_EXPLICIT;
+    } else {
+        fprintf(stderr, "fvmr -> Expected 'transparent' or 'explicit' for --huge-pages, not '%s'\n", backing);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+_Bool options_parse(int argc, char **argv) { // Fill fvmr_options from the command line
+    _Bool engine_given = 0; // (Since the default engine can also be asked for by name)
+
+    for(int i = 1; i < argc; i++) {
+        if(!strncmp(argv[i], "--engine=", 9)) { // --engine=<name>
+            if(options_parse_engine(argv[i] + 9))
+                return 1;
+
+            engine_given = 1;
+        } else if(!strcmp(argv[i], "--stats")) { // --stats
+            fvmr_options.stats = 1;
+        } else if(!strcmp(argv[i], "--no-fusion")) { // --no-fusion
+            fvmr_options.fusion = 0;
+        } else if(!strcmp(argv[i], "--no-quickening")) { // --no-quickening
+            fvmr_options.quickening = 0;
+        } else if(!strcmp(argv[i], "--perf-map")) { // --perf-map
+            fvmr_options.perf_map = 1;
+        } else if(!strcmp(argv[i], "--cache")) { // --cache
+            fvmr_options.cache = FVM_CACHE;
+        } else if(!strncmp(argv[i], "--cache=", 8)) { // --cache=<directory>
+            fvmr_options.cache = argv[i] + 8;
+        } else if(!strncmp(argv[i], "--batch=", 8)) { // --batch=<file>
+            fvmr_options.batch = argv[i] + 8;
+        } else if(!strncmp(argv[i], "--workers=", 10)) { // --workers=<n>
+            if(options_parse_count("--workers", argv[i] + 10, &fvmr_options.workers))
+                return 1;
+        } else if(!strncmp(argv[i], "--quantum=", 10)) { // --quantum=<instructions>
+            if(options_parse_count("--quantum", argv[i] + 10, &fvmr_options.quantum))
+                return 1;
+        } else if(!strncmp(argv[i], "--fork-server=", 14)) { // --fork-server=<file>
+            fvmr_options.fork_server = argv[i] + 14;
+        } else if(!strncmp(argv[i], "--snapshot-after=", 17)) { // --snapshot-after=<instructions>
+            if(options_parse_count("--snapshot-after", argv[i] + 17, &fvmr_options.snapshot_after))
+                return 1;
+        } else if(!strncmp(argv[i], "--snapshot-at=", 14)) { // --snapshot-at=<address>
+            if(options_parse_count("--snapshot-at", argv[i] + 14, &fvmr_options.snapshot_at))
+                return 1;
+        } else if(!strcmp(argv[i], "--checkpoint")) { // --checkpoint
+            fvmr_options.checkpoint = FVM_CHECKPOINT;
+        } else if(!strncmp(argv[i], "--checkpoint=", 13)) { // --checkpoint=<file>
+            fvmr_options.checkpoint = argv[i] + 13;
+        } else if(!strncmp(argv[i], "--checkpoint-every=", 19)) { // --checkpoint-every=<instructions>
+            if(options_parse_count("--checkpoint-every", argv[i] + 19, &fvmr_options.checkpoint_every))
+                return 1;
+        } else if(!strncmp(argv[i], "--resume=", 9)) { // --resume=<file>
+            fvmr_options.resume = argv[i] + 9;
+        } else if(!strncmp(argv[i], "--max-instructions=", 19)) { // --max-instructions=<instructions>
+            if(options_parse_count("--max-instructions", argv[i] + 19, &fvmr_options.max_instructions))
+                return 1;
+        } else if(!strncmp(argv[i], "--max-seconds=", 14)) { // --max-seconds=<seconds>
+            if(options_parse_seconds("--max-seconds", argv[i] + 14, &fvmr_options.max_seconds))
+                return 1;
+#ifdef FVMR_HEADLESS
+        } else if(!strncmp(argv[i], "--keyboard=", 11)) { // --keyboard=<file>
+            fvmr_options.keyboard = argv[i] + 11;
+#endif
+        } else if(!strncmp(argv[i], "--rom=", 6)) { // --rom=<file>
+            fvmr_options.rom = argv[i] + 6;
+        } else if(!strncmp(argv[i], "--max-memory=", 13)) { // --max-memory=<cells>
+            if(options_parse_count("--max-memory", argv[i] + 13, &fvmr_options.max_memory))
+                return 1;
+        } else if(!strncmp(argv[i], "--max-callstack=", 16)) { // --max-callstack=<cells>
+            if(options_parse_count("--max-callstack", argv[i] + 16, &fvmr_options.max_callstack))
+                return 1;
+        } else if(!strncmp(argv[i], "--huge-pages=", 13)) { // --huge-pages=transparent or --huge-pages=explicit
+            if(options_parse_huge_pages(argv[i] + 13))
+                return 1;
+        } else if(!strncmp(argv[i], "--poll=", 7)) { // --poll=io, --poll=<instructions> or --poll=<milliseconds>ms
+            if(options_parse_poll(argv[i] + 7))
+                return 1;
+        } else {
+            fprintf(stderr, "fvmr -> Unrecognised argument '%s'\n", argv[i]);
+
+            return 1;
+        }
+    }
+
+    if(fvmr_options.fork_server != NULL && fvmr_options.snapshot_after == UINT64_MAX && fvmr_options.snapshot_at == UINT64_MAX) {
+        fprintf(stderr, "fvmr -> --fork-server needs --snapshot-after= or --snapshot-at= to say where to take the snapshot\n");
+
+        return 1;
+    }
+
+    if(fvmr_options.fork_server != NULL && fvmr_options.batch != NULL) {
+        fprintf(stderr, "fvmr -> --fork-server and --batch can't be used together\n");
+
+        return 1;
+    }
+
+    if(fvmr_options.checkpoint_every && fvmr_options.checkpoint == NULL) // Checkpoints every so many instructions go to the default file unless told otherwise
+        fvmr_options.checkpoint = FVM_CHECKPOINT;
+
+    if((fvmr_options.checkpoint != NULL || fvmr_options.resume != NULL) && (fvmr_options.batch != NULL || fvmr_options.fork_server != NULL)) {
+        fprintf(stderr, "fvmr -> --checkpoint and --resume can't be used with --batch or --fork-server\n");
+
+        return 1;
+    }
+
+    if((fvmr_options.max_instructions != UINT64_MAX || fvmr_options.max_seconds > 0) && fvmr_options.batch != NULL) { // Guests are preempted long before any budget would be reached, and have their own instruction counts
+        fprintf(stderr, "fvmr -> --max-instructions and --max-seconds can't be used with --batch\n");
+
+        return 1;
+    }
+
+    if(engine_given && fvmr_options.batch != NULL) { // Guests always run on the pinned engine, as the embedding API runs them (see vm.h)
+        fprintf(stderr, "fvmr -> --engine can't be used with --batch\n");
+
+        return 1;
+    }
+
+    if(fvmr_options.stats && fvmr_options.batch != NULL) { // The batch's own report already has each guest's instructions and time, and the totals
+        fprintf(stderr, "fvmr -> --stats can't be used with --batch\n");
+
+        return 1;
+    }
+
+    if(fvmr_options.huge_pages != FVMR_HUGE_PAGES_NONE && fvmr_options.batch != NULL) { // Guests each have their own small Main Memory on the heap
+        fprintf(stderr, "fvmr -> --huge-pages can't be used with --batch\n");
+
+        return 1;
+    }
+
+    if(fvmr_options.huge_pages == FVMR_HUGE_PAGES_EXPLICIT && fvmr_options.resume != NULL) { // A checkpoint is loaded onto the heap, which can only be advised to use huge pages
+        fprintf(stderr, "fvmr -> --huge-pages=explicit can't be used with --resume, only --huge-pages=transparent\n");
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,53 @@
+#ifndef FVMR_OPTIONS_H
+
+#define FVMR_OPTIONS_H
+
+#include <string.h>
+#include "global.h"
+
+enum fvmr_engine { // Execution engines that can be selected from the command line
+    FVMR_ENGINE_TABLE = 0, // Function-pointer table dispatch (instructions[])
+    FVMR_ENGINE_THREADED = 1, // Direct-threaded dispatch with inlined handlers
+    FVMR_ENGINE_BLOCK = 2, // Cached basic blocks, chained directly to each other
+    FVMR_ENGINE_JIT = 3, // Cached basic blocks, with hot ones translated into native code
+    FVMR_ENGINE_PINNED = 4 // Switch dispatch over Main Memory, with the registers held in locals
+};
+
+enum fvmr_huge_pages { // How Main Memory is backed with huge pages
+    FVMR_HUGE_PAGES_NONE = 0, // Not at all, beyond whatever the kernel does by default
+    FVMR_HUGE_PAGES_TRANSPARENT = 1, // Advised to the kernel as wanting transparent huge pages (madvise())
+    FVMR_HUGE_PAGES_EXPLICIT = 2 // Mapped from the kernel's pool of huge pages (MAP_HUGETLB), which have to have been set aside for it
+};
+
+extern const char *ENGINE_NAMES[]; // Names of the engines as accepted by --engine=
+
+extern struct fvmr_options { // Runtime configuration as given on the command line
+    enum fvmr_engine engine; // Engine used to execute the ROM
+    enum fvmr_huge_pages huge_pages; // How Main Memory is backed with huge pages
+    _Bool stats, // Print execution statistics on exit
+          fusion, // Fuse common pairs of instructions when decoding
+          quickening, // Specialise st/ld sites to the channel they use
+          perf_map; // Write /tmp/perf-<pid>.map for the jit engine's translations
+    const char *cache, // Directory to keep decoded streams and hot blocks in across runs (NULL for none)
+               *batch, // File listing guests to run together on the scheduler instead of the ROM (NULL for none)
+               *fork_server, // File listing jobs to fork from a snapshot of the ROM (NULL for none)
+               *checkpoint, // File to write checkpoints to on SIGUSR1 (NULL for none)
+               *resume, // Checkpoint to carry on from instead of running the ROM (NULL for none)
+               *keyboard, // Keyboard file for fvmr-headless (NULL for no keypresses)
+               *rom; // ROM file to run (FVM_ROM unless given)
+    uint64_t workers, // Number of worker threads for --batch, or jobs at once for --fork-server (0 for one per online CPU)
+             quantum, // Instructions a guest runs for under --batch before it's preempted
+             snapshot_after, // Instructions to run before the snapshot for --fork-server (UINT64_MAX for no limit)
+             snapshot_at, // Address to take the snapshot for --fork-server at, before running the instruction there (UINT64_MAX for none)
+             checkpoint_every, // Instructions between checkpoints (0 for only on SIGUSR1)
+             max_instructions, // Instructions the ROM may run before it's stopped with FVMR_EXIT_FAILURE_BUDGET (UINT64_MAX for no limit)
+             poll_every, // Instructions between polls for window events (UINT64_MAX for only at the guest's graphics and keyboard operations)
+             poll_interval, // Milliseconds between polls for window events, instead of every so many instructions (0 for none)
+             max_memory, // Cells of Main Memory the ROM (or each guest under --batch) may use (UINT64_MAX for no limit)
+             max_callstack; // Cells of Callstack the ROM (or each guest under --batch) may use (UINT64_MAX for no limit)
+    double max_seconds; // Wall-clock seconds the ROM may run for before it's stopped with FVMR_EXIT_FAILURE_BUDGET (0 for no limit)
+} fvmr_options;
+
+extern _Bool options_parse(int argc, char **argv); // Fill fvmr_options from the command line, returns 1 if an argument was not understood
+
+#endif
@@ -0,0 +1,255 @@
+/* Fox Virtual Machine: Paged Memory
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// The page table has two levels: the directory finds the chunk covering an address, and the kernel's own page table,
+// over the chunk's mapping, finds the page within it. Mapping chunks with MAP_NORESERVE means that none of their pages
+// cost anything until they're written to, at which point the kernel gives each one a zeroed physical page.
+
+#include "paged.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+
+FVMR_VM_STATE struct fvmr_paged paged = PAGED_DEFAULTS;
+
+static uint64_t paged_slot(const struct fvmr_paged *pages, uint64_t index) { // Slot in the directory holding the chunk at index, or the empty slot where it would go
+    uint64_t slot = (index * UINT64_C(0x9e3779b97f4a7c15)) >> 32 & (pages->size - 1);
+
+    while(pages->directory[slot] != NULL && pages->directory[slot]->index != index)
+        slot = (slot + 1) & (pages->size - 1);
+
+    return slot;
+}
+
+static struct paged_chunk *paged_find(const struct fvmr_paged *pages, uint64_t index) { // Chunk at index, or NULL if it isn't mapped
+    if(!pages->length)
+        return NULL;
+
+    if(pages->last != NULL && pages->last->index == index)
+        return pages->last;
+
+    return pages->directory[paged_slot(pages, index)];
+}
+
+static _Bool paged_grow(struct fvmr_paged *pages) { // Double the directory, returns 1 on failure
+    struct paged_chunk **directory = pages->directory;
+    uint64_t size = pages->size;
+
+    pages->size = size ? size * 2 : 64;
+
+    if((pages->directory = calloc(pages->size, sizeof(struct paged_chunk *))) == NULL) {
+        pages->directory = directory;
+        pages->size = size;
+
+        return 1;
+    }
+
+    for(uint64_t i = 0; i < size; i++) // Rehash every chunk into the new directory
+        if(directory[i] != NULL)
+            pages->directory[paged_slot(pages, directory[i]->index)] = directory[i];
+
+    free(directory);
+
+    return 0;
+}
+
+static struct paged_chunk *paged_map(struct fvmr_paged *pages, uint64_t index) { // Chunk at index, mapping it if it isn't already, returns NULL on failure
+    struct paged_chunk *chunk;
+    uint64_t slot;
+
+    if((chunk = paged_find(pages, index)) != NULL)
+        return pages->last = chunk;
+
+    if((pages->length + 1) * 2 > pages->size && paged_grow(pages)) // Kept at most half full
+        return NULL;
+
+    if((chunk = calloc(1, sizeof(struct paged_chunk))) == NULL)
+        return NULL;
+
+    if((chunk->cells = mmap(NULL, PAGED_CHUNK_CELLS * sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)) == MAP_FAILED) {
+        free(chunk);
+
+        return NULL;
+    }
+
+    chunk->index = index;
+
+    slot = paged_slot(pages, index);
+
+    pages->directory[slot] = chunk;
+    pages->length++;
+
+    return pages->last = chunk;
+}
+
+static uint64_t paged_covered(const struct fvmr_paged *pages, uint64_t from, uint64_t to, _Bool forget) { // Number of pages written to whose last cell is between from and to, which memory growing from from to to covers all of, forgetting them if forget (leaving the caller to uncount them)
+    struct paged_chunk *chunk = NULL;
+    uint64_t covered = 0,
+             bit;
+
+    if(pages->lowest >= to) // Nothing written that low
+        return 0;
+
+    for(uint64_t page = from >> PAGED_PAGE_SHIFT; page < to >> PAGED_PAGE_SHIFT; page++) {
+        bit = page & (PAGED_CHUNK_PAGES - 1);
+
+        if(page == from >> PAGED_PAGE_SHIFT || !bit)
+            chunk = paged_find(pages, page >> (PAGED_CHUNK_SHIFT - PAGED_PAGE_SHIFT));
+
+        if(chunk == NULL) { // On to the next chunk
+            page |= PAGED_CHUNK_PAGES - 1;
+
+            continue;
+        }
+
+        if(chunk->touched[bit >> 6] & (uint64_t)1 << (bit & 63)) {
+            covered++;
+
+            if(forget) { // Given back to the kernel as well, since the array is the authority below its length
+                chunk->touched[bit >> 6] &= ~((uint64_t)1 << (bit & 63));
+
+                madvise(&chunk->cells[bit << PAGED_PAGE_SHIFT], sizeof(uint64_t) << PAGED_PAGE_SHIFT, MADV_DONTNEED);
+            }
+        }
+    }
+
+    return covered;
+}
+
+static void paged_absorb(struct fvm_file *memory, struct fvmr_paged *pages, uint64_t from, uint64_t to) { // Copy whatever was paged between from and to into memory, which has just grown over it, and stop counting the pages it now has all of
+    struct paged_chunk *chunk;
+    uint64_t next;
+
+    for(uint64_t at = from; at < to; at = next) {
+        next = ((at >> PAGED_CHUNK_SHIFT) + 1) << PAGED_CHUNK_SHIFT;
+
+        if(next > to || !next) // (next wraps to 0 in the last chunk of the address space)
+            next = to;
+
+        if((chunk = paged_find(pages, at >> PAGED_CHUNK_SHIFT)) != NULL)
+            memcpy(&memory->self[at], &chunk->cells[at & (PAGED_CHUNK_CELLS - 1)], (next - at) * sizeof(uint64_t));
+    }
+
+    pages->pages -= paged_covered(pages, from, to, 1); // Once they're copied (a page it only has part of stays paged, and counted, until it grows over the rest)
+}
+
+_Bool paged_write(struct fvmr_paged *pages, uint64_t address, uint64_t value) { // Write value to pages itself
+    struct paged_chunk *chunk;
+    uint64_t offset = address & (PAGED_CHUNK_CELLS - 1),
+             page = offset >> PAGED_PAGE_SHIFT;
+
+    if((chunk = paged_map(pages, address >> PAGED_CHUNK_SHIFT)) == NULL) {
+        errno = ENOMEM;
+
+        return 1;
+    }
+
+    chunk->cells[offset] = value;
+
+    if(!(chunk->touched[page >> 6] & (uint64_t)1 << (page & 63))) {
+        chunk->touched[page >> 6] |= (uint64_t)1 << (page & 63);
+
+        pages->pages++;
+    }
+
+    if(address < pages->lowest)
+        pages->lowest = address;
+
+    return 0;
+}
+
+_Bool paged_store(struct fvm_file *memory, struct fvmr_paged *pages, uint64_t address, uint64_t value) { // Write value at or past the end of memory
+    if(address >= PAGED_REACH(memory)) // Too far to grow Main Memory to
+        return paged_write(pages, address, value);
+
+    if(file_reserve(memory, address))
+        return 1;
+
+    if(pages->lowest <= address)
+        paged_absorb(memory, pages, memory->length, address + 1);
+
+    memory->length = address + 1;
+    memory->self[address] = value;
+
+    return 0;
+}
+
+uint64_t paged_cost(const struct fvm_file *memory, const struct fvmr_paged *pages, uint64_t address) { // Cells that a store to address would add
+    struct paged_chunk *chunk;
+    uint64_t page = (address & (PAGED_CHUNK_CELLS - 1)) >> PAGED_PAGE_SHIFT,
+             cells,
+             covered;
+
+    if(address < memory->length)
+        return 0;
+
+    if(address < PAGED_REACH(memory)) { // Main Memory grows up to it, over any pages it then has all of, which stop being counted
+        cells = address + 1 - memory->length;
+        covered = paged_covered(pages, memory->length, address + 1, 0) << PAGED_PAGE_SHIFT;
+
+        return cells > covered ? cells - covered : 0;
+    }
+
+    if((chunk = paged_find(pages, address >> PAGED_CHUNK_SHIFT)) != NULL && chunk->touched[page >> 6] & (uint64_t)1 << (page & 63)) // Its page is already counted
+        return 0;
+
+    return (uint64_t)1 << PAGED_PAGE_SHIFT;
+}
+
+uint64_t paged_load(const struct fvmr_paged *pages, uint64_t address) { // Value past the end of Main Memory
+    struct paged_chunk *chunk = paged_find(pages, address >> PAGED_CHUNK_SHIFT);
+
+    return chunk != NULL ? chunk->cells[address & (PAGED_CHUNK_CELLS - 1)] : 0;
+}
+
+static int paged_compare(const void *a, const void *b) { // Order chunks by address, for qsort()
+    uint64_t x = (*(struct paged_chunk *const *)a)->index,
+             y = (*(struct paged_chunk *const *)b)->index;
+
+    return (x > y) - (x < y);
+}
+
+uint64_t paged_sorted(const struct fvmr_paged *pages, struct paged_chunk ***chunks) { // Every chunk, in order of address
+    uint64_t length = 0;
+
+    if(!pages->length || (*chunks = malloc(pages->length * sizeof(struct paged_chunk *))) == NULL) {
+        *chunks = NULL;
+
+        return 0;
+    }
+
+    for(uint64_t i = 0; i < pages->size; i++)
+        if(pages->directory[i] != NULL)
+            (*chunks)[length++] = pages->directory[i];
+
+    qsort(*chunks, length, sizeof(struct paged_chunk *), paged_compare);
+
+    return length;
+}
+
+void paged_report(void) { // Print how much paged memory was used
+    if(!paged.length)
+        return;
+
+    fprintf(stderr, "\tPaged memory: %zu pages written across %zu chunks (%zuKiB resident at most)\n", paged.pages, paged.length, paged.pages << (PAGED_PAGE_SHIFT + 3) >> 10);
+}
+
+void paged_end(struct fvmr_paged *pages) { // Unmap every chunk, and cleanup
+    for(uint64_t i = 0; i < pages->size; i++) {
+        if(pages->directory[i] == NULL)
+            continue;
+
+        munmap(pages->directory[i]->cells, PAGED_CHUNK_CELLS * sizeof(uint64_t));
+        free(pages->directory[i]);
+    }
+
+    free(pages->directory);
+
+    *pages = (struct fvmr_paged)PAGED_DEFAULTS;
+}
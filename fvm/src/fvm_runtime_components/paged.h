@@ -0,0 +1,54 @@
+#ifndef FVMR_PAGED_H
+
+#define FVMR_PAGED_H
+
+#include "global.h"
+
+// Main Memory is the contiguous array in files[MEM], which the engines read and write directly, backed by paged memory
+// for everything past its end. A store past the end grows the array if the address is within reach of it (see
+// PAGED_REACH()), and otherwise goes to paged memory: a directory of chunks, each an anonymous mapping that the kernel
+// only backs with a physical page once it's written to. So a guest using high addresses for its heap or stack only pays
+// for the pages it touches, and untouched pages (and addresses with no chunk at all) read as zero. When the array grows
+// over addresses that were paged, it copies them in, so that the array is always the authority below its length.
+
+#define PAGED_PAGE_SHIFT 9 // Cells in a page (512, a 4KiB page)
+#define PAGED_CHUNK_SHIFT 18 // Cells in a chunk (2MiB of address space)
+#define PAGED_CHUNK_CELLS ((uint64_t)1 << PAGED_CHUNK_SHIFT)
+#define PAGED_CHUNK_PAGES ((uint64_t)1 << (PAGED_CHUNK_SHIFT - PAGED_PAGE_SHIFT))
+#define PAGED_REACH_MIN ((uint64_t)1 << 20) // Main Memory can always grow to this many cells without going to paged memory
+#define PAGED_REACH_GROWN(cells) ((cells) > PAGED_REACH_MIN / 2 ? (cells) * 2 : PAGED_REACH_MIN) // Reach of Main Memory with this many cells, so that growing it at most doubles it
+#define PAGED_REACH(memory) ((memory)->mapped ? (PAGED_REACH_GROWN((memory)->length) < (memory)->mapped ? PAGED_REACH_GROWN((memory)->length) : (memory)->mapped) : PAGED_REACH_GROWN((memory)->size)) // Addresses below this are stored by growing Main Memory (in place, within the reservation, if it's mapped)
+
+#define PAGED_DEFAULTS { /* No paged memory */ \
+    .directory = NULL, \
+    .last = NULL, \
+    .size = 0, \
+    .length = 0, \
+    .pages = 0, \
+    .lowest = UINT64_MAX \
+}
+
+struct paged_chunk { // PAGED_CHUNK_CELLS cells of paged memory
+    uint64_t index, // Its address >> PAGED_CHUNK_SHIFT
+             *cells, // Mapped, and zero until written to
+             touched[PAGED_CHUNK_PAGES / 64]; // Bitmap of the pages that have been written to
+};
+
+extern FVMR_VM_STATE struct fvmr_paged { // Paged memory past the end of Main Memory
+    struct paged_chunk **directory, // Open-addressed on the chunk's index (NULL for an empty slot)
+                       *last; // Chunk found by the last lookup, which the next one is likely to want again
+    uint64_t size, // Slots in directory (a power of 2)
+             length, // Chunks mapped
+             pages, // Pages written to, and not since grown over by Main Memory
+             lowest; // Lowest address written to (UINT64_MAX if none has been)
+} paged;
+
+extern _Bool paged_write(struct fvmr_paged *pages, uint64_t address, uint64_t value); // Write value to pages itself, whether or not Main Memory could have grown to address. Returns 1 (with errno set) on failure
+extern _Bool paged_store(struct fvm_file *memory, struct fvmr_paged *pages, uint64_t address, uint64_t value); // Write value to an address at or past the end of memory, either by growing memory to reach it or to pages. Returns 1 (with errno set) on failure
+extern uint64_t paged_cost(const struct fvm_file *memory, const struct fvmr_paged *pages, uint64_t address); // Cells that a store to address, at or past the end of memory, would add to what memory and pages use between them (0 if growing memory over pages would use less)
+extern uint64_t paged_load(const struct fvmr_paged *pages, uint64_t address); // Value at an address past the end of Main Memory (0 if it was never written)
+extern uint64_t paged_sorted(const struct fvmr_paged *pages, struct paged_chunk ***chunks); // Point *chunks at a new array of every chunk in pages, in order of address, returning how many there are (the array is NULL if there are none, or if it couldn't be allocated)
+extern void paged_report(void); // Print how much paged memory was used
+extern void paged_end(struct fvmr_paged *pages); // Unmap every chunk, and cleanup
+
+#endif
@@ -0,0 +1,270 @@
+/* Fox Virtual Machine: Register-pinned Interpreter
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// This engine interprets Main Memory directly, exactly as table_run() does, but with every handler inlined into one switch
+// and every register held in a local. The handlers in instructions.c go through fvm_registers[] and files[MEM] in memory
+// on every operation, since the compiler can't keep globals in host registers across the indirect call to each handler.
+// Here, the registers and Main Memory's base and length are only written back when something outside the loop can see
+// them: st/ld to anything but Main Memory (which goes through store() and load()), and stopping, for the traceback.
+// Likewise, service_run() is only checked for at jumps, so that straight-line code never has to touch anything but locals.
+
+#include "pinned.h"
+
+#define PINNED_READ(r) ( /* Value of register r, which has been checked against NO_REGISTERS */ \
+        (r) == MCH ? mch : \
+        (r) == MAR ? mar : \
+        (r) == MDR ? mdr : \
+        (r) == ACC ? acc : \
+        (r) == DAT ? dat : \
+        (r) == CEA ? cea : \
+        (r) == CSP ? csp : \
+        gp[(r) - GP0])
+
+#define PINNED_WRITE(r, value) do { /* Set register r to value, which has been checked against NO_REGISTERS */ \
+        switch(r) { \
+            case MCH: mch = (value); break; \
+            case MAR: mar = (value); break; \
+            case MDR: mdr = (value); break; \
+            case ACC: acc = (value); break; \
+            case DAT: dat = (value); break; \
+            case CEA: cea = (value); break; \
+            case CSP: csp = (value); break; \
+            default: gp[(r) - GP0] = (value); \
+        } \
+    } while(0)
+
+#define PINNED_WRITE_BACK() do { /* Write every register back to fvm_registers */ \
+        fvm_registers[MCH] = mch; \
+        fvm_registers[MAR] = mar; \
+        fvm_registers[MDR] = mdr; \
+        fvm_registers[ACC] = acc; \
+        fvm_registers[DAT] = dat; \
+        fvm_registers[CEA] = cea; \
+        fvm_registers[CSP] = csp; \
+        \
+        memcpy(&fvm_registers[GP0], gp, sizeof(gp)); \
+    } while(0)
+
+#define PINNED_DEVICE(access) do { /* Run store() or load() with the registers that they use written back, then pick up what they changed */ \
+        fvm_registers[MCH] = mch; \
+        fvm_registers[MAR] = mar; \
+        fvm_registers[MDR] = mdr; \
+        fvm_registers[CEA] = cea; \
+        memcpy(&fvm_registers[GP0], gp, sizeof(gp)); /* (Which bulk operations take their operands from) */ \
+        \
+        if(access()) \
+            goto execution_error; \
+        \
+        mdr = fvm_registers[MDR]; \
+        mem = files[MEM].self; \
+        length = files[MEM].length; \
+    } while(0)
+
+static inline __attribute__((always_inline)) _Bool pinned_execute(uint64_t steps, uint64_t marker, const _Bool marked) { // Execute from CEA with the registers in locals, checking CEA against marker only if marked, which is constant in each caller so that pinned_run() doesn't pay for it
+    uint64_t *mem = files[MEM].self, // Main Memory, reloaded after anything that could have reallocated it
+             length = files[MEM].length,
+             mch = fvm_registers[MCH],
+             mar = fvm_registers[MAR],
+             mdr = fvm_registers[MDR],
+             acc = fvm_registers[ACC],
+             dat = fvm_registers[DAT],
+             cea = fvm_registers[CEA],
+             csp = fvm_registers[CSP],
+             gp[GP7 - GP0 + 1],
+             executed = 0,
+             value;
+    _Bool exhausted = 0;
+
+    memcpy(gp, &fvm_registers[GP0], sizeof(gp));
+
+    for(; mem[cea] != 27; cea++) { // Traverse instructions until instruction 27 (fi - finish) is encountered
+        if(executed == steps || (marked && cea == marker)) {
+            exhausted = 1;
+
+            goto end;
+        }
+
+        switch(mem[cea]) {
+            case 0: // pl <value> <register>
+                if(mem[cea + 2] >= NO_REGISTERS) {
+                    fprintf(stderr, "fvmr -> Attempted to place value into unknown register '%zu'\n", mem[cea + 2]);
+
+                    goto execution_error;
+                }
+
+                value = mem[cea + 1];
+
+                PINNED_WRITE(mem[cea + 2], value);
+
+                if(mem[cea + 2] == CEA) {
+                    cea += 2;
+                    goto transfer;
+                }
+
+                cea += 2;
+                break;
+            case 1: // mv <register> <register>
+                if(mem[cea + 2] >= NO_REGISTERS) {
+                    fprintf(stderr, "fvmr -> Attempted to move register's value into unknown register '%zu'\n", mem[cea + 2]);
+
+                    goto execution_error;
+                }
+
+                if(mem[cea + 1] >= NO_REGISTERS) {
+                    fprintf(stderr, "fvmr -> Attempted to move value in unknown register '%zu' into another register\n", mem[cea + 1]);
+
+                    goto execution_error;
+                }
+
+                value = PINNED_READ(mem[cea + 1]);
+
+                PINNED_WRITE(mem[cea + 2], value);
+
+                if(mem[cea + 2] == CEA) {
+                    cea += 2;
+                    goto transfer;
+                }
+
+                cea += 2;
+                break;
+            case 2: // st
+                if(mch == MEM && mar < length)
+                    mem[mar] = mdr;
+                else
+                    PINNED_DEVICE(store);
+
+                break;
+            case 3: // ld
+                if(mch == MEM)
+                    mdr = mar < length ? mem[mar] : paged_load(&paged, mar);
+                else
+                    PINNED_DEVICE(load);
+
+                break;
+            case 4: // jm <address>
+                cea = mem[cea + 1] - 1;
+                goto transfer;
+            case 5: // js <address>
+                cea = acc ? mem[cea + 1] - 1 : cea + 1;
+                goto transfer;
+            case 6: // jc <address>
+                cea = !acc ? mem[cea + 1] - 1 : cea + 1;
+                goto transfer;
+            case 7: // a+
+                acc += dat;
+                break;
+            case 8: // a-
+                acc -= dat;
+                break;
+            case 9: // a!
+                acc = ~acc;
+                break;
+            case 10: // ai
+                acc++;
+                break;
+            case 11: // ad
+                acc--;
+                break;
+            case 12: // a*
+                acc *= dat;
+                break;
+            case 13: // a/
+                acc /= dat;
+                break;
+            case 14: // a&
+                acc &= dat;
+                break;
+            case 15: // a|
+                acc |= dat;
+                break;
+            case 16: // a^
+                acc ^= dat;
+                break;
+            case 17: // al
+                acc <<= dat;
+                break;
+            case 18: // ar
+                acc >>= dat;
+                break;
+            case 19: // gt
+                acc = acc > dat;
+                break;
+            case 20: // lt
+                acc = acc < dat;
+                break;
+            case 21: // ge
+                acc = acc >= dat;
+                break;
+            case 22: // le
+                acc = acc <= dat;
+                break;
+            case 23: // eq
+                acc = acc == dat;
+                break;
+            case 24: // ne
+                acc = acc != dat;
+                break;
+            case 25: // cl <address>
+                if(quota_push()) // Grow the callstack if it needs to include the address of this call
+                    goto execution_error;
+
+                csp = files[CST].length - 1;
+                files[CST].self[csp] = cea; // Push CEA onto the Callstack
+                cea = mem[cea + 1] - 1;
+                goto transfer;
+            case 26: // rt
+                if(!(csp + 1)) { // If there is nothing to pop from the Callstack
+                    fprintf(stderr, "fvmr -> Callstack underflow");
+
+                    goto execution_error;
+                }
+
+                files[CST].length = csp;
+                cea = files[CST].self[csp--] + 1;
+                goto transfer;
+            default:
+                fprintf(stderr, "fvmr -> Encountered unknown instruction '%zu'\n", mem[cea]);
+
+                goto execution_error;
+        }
+
+        executed++;
+
+        continue;
+
+    transfer: // Anything from service_run() is checked for once per jump rather than once per instruction, as in the block engine
+        executed++;
+
+        if(SERVICE_DUE(executed)) {
+            PINNED_WRITE_BACK();
+
+            if(service_run(cea + 1, executed))
+                goto end;
+        }
+    }
+
+    goto end;
+
+execution_error:
+    fvmr_exit_code = FVMR_EXIT_FAILURE_EXECUTION;
+
+end: // Write everything back for the traceback
+    PINNED_WRITE_BACK();
+
+    fvmr_stats.instructions += executed;
+
+    return exhausted;
+}
+
+_Bool pinned_run(uint64_t steps) { // Execute from CEA with the registers in locals
+    return pinned_execute(steps, 0, 0);
+}
+
+_Bool pinned_run_to(uint64_t steps, uint64_t marker) { // Execute from CEA with the registers in locals until marker
+    return pinned_execute(steps, marker, 1);
+}
@@ -0,0 +1,11 @@
+#ifndef FVMR_PINNED_H
+
+#define FVMR_PINNED_H
+
+#include "global.h"
+#include "instructions.h"
+
+extern _Bool pinned_run(uint64_t steps); // Execute from CEA like table_run(), but with the registers and Main Memory's base and length in locals, until fi, an error (setting fvmr_exit_code), or steps instructions have run. Returns 1 in the last case, with CEA on the next instruction
+extern _Bool pinned_run_to(uint64_t steps, uint64_t marker); // pinned_run(), but also stopping (and returning 1) when CEA reaches marker, before running the instruction there
+
+#endif
@@ -0,0 +1,102 @@
+/* Fox Virtual Machine: Memory Quotas
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// The limits are only checked where memory grows: a store past the end of Main Memory, a store to the Callstack, and a
+// call deeper than any before it. Everything within what's already in use runs as it did, without a check.
+
+#include "quota.h"
+
+#include <sys/resource.h>
+
+FVMR_VM_STATE struct fvmr_quota quota = QUOTA_DEFAULTS;
+
+void quota_init(uint64_t memory, uint64_t callstack) { // Set the limits for the VM running on this thread
+    quota.memory_limit = memory;
+    quota.callstack_limit = callstack;
+    quota.callstack_peak = files[CST].length; // (Which a resumed checkpoint may already have some of)
+}
+
+_Bool quota_memory_exceeded(uint64_t address) { // If a store to address would take Main Memory past its limit
+    return quota_memory_exceeded_by(&files[MEM], &paged, &quota, address);
+}
+
+_Bool quota_memory_exceeded_by(const struct fvm_file *memory, const struct fvmr_paged *pages, const struct fvmr_quota *limits, uint64_t address) { // If a store to address would take a VM's Main Memory past its limit
+    return limits->memory_limit != UINT64_MAX && memory->length + (pages->pages << PAGED_PAGE_SHIFT) + paged_cost(memory, pages, address) > limits->memory_limit;
+}
+
+_Bool quota_memory(uint64_t address) { // Check that a store to address keeps Main Memory within its limit
+    return quota_memory_by(&files[MEM], &paged, &quota, address);
+}
+
+_Bool quota_memory_by(const struct fvm_file *memory, const struct fvmr_paged *pages, const struct fvmr_quota *limits, uint64_t address) { // Check that a store to address keeps a VM's Main Memory within its limit
+    if(!quota_memory_exceeded_by(memory, pages, limits, address))
+        return 0;
+
+    fprintf(stderr, "fvmr -> Main Memory limit of %zu cells exceeded by a write to address %zu\n", limits->memory_limit, address);
+
+    return 1;
+}
+
+_Bool quota_callstack(uint64_t address) { // Check that address is within the Callstack's limit
+    if(address < quota.callstack_limit)
+        return 0;
+
+    fprintf(stderr, "fvmr -> Callstack limit of %zu cells exceeded at address %zu\n", quota.callstack_limit, address);
+
+    return 1;
+}
+
+void quota_usage(const struct fvm_file *memory, const struct fvmr_paged *pages, const struct fvm_file *callstack, const struct fvmr_quota *limits, struct fvmr_usage *usage) { // Fill usage for a VM
+    usage->paged = pages->pages << PAGED_PAGE_SHIFT;
+    usage->memory = memory->length + usage->paged;
+    usage->callstack = callstack->length;
+    usage->callstack_peak = limits->callstack_peak > callstack->length ? limits->callstack_peak : callstack->length;
+}
+
+static uint64_t quota_huge_pages(void) { // KiB of this process that's backed by transparent huge pages (0 if it can't be found out)
+    char line[128];
+    uint64_t kib = 0;
+    FILE *f;
+
+    if((f = fopen("/proc/self/smaps_rollup", "r")) == NULL)
+        return 0;
+
+    while(fgets(line, sizeof(line), f) != NULL)
+        if(sscanf(line, "AnonHugePages: %zu kB", &kib) == 1)
+            break;
+
+    fclose(f);
+
+    return kib;
+}
+
+void quota_report(void) { // Print how much memory was used
+    struct fvmr_usage usage;
+    struct rusage resources;
+    uint64_t huge;
+
+    quota_usage(&files[MEM], &paged, &files[CST], &quota, &usage);
+
+    fprintf(stderr, "\tMain Memory used: %zu cells (%zu of them paged)", usage.memory, usage.paged);
+
+    if(quota.memory_limit != UINT64_MAX)
+        fprintf(stderr, " of a limit of %zu", quota.memory_limit);
+
+    fprintf(stderr, "\n\tCallstack used: %zu cells at most (%zu at the end)", usage.callstack_peak, usage.callstack);
+
+    if(quota.callstack_limit != UINT64_MAX)
+        fprintf(stderr, " of a limit of %zu", quota.callstack_limit);
+
+    fprintf(stderr, "\n");
+
+    if(!getrusage(RUSAGE_SELF, &resources))
+        fprintf(stderr, "\tPeak resident set: %ldKiB\n", resources.ru_maxrss);
+
+    if((huge = quota_huge_pages()))
+        fprintf(stderr, "\tIn transparent huge pages: %zuKiB\n", huge);
+}
@@ -0,0 +1,58 @@
+#ifndef FVMR_QUOTA_H
+
+#define FVMR_QUOTA_H
+
+// Limits on how much memory a guest may use, so that one that runs away faults (with a traceback, as any failed st or
+// cl does) rather than taking the host down with it. Main Memory is counted as its contiguous cells plus each page of
+// paged memory written to that they haven't since grown over, which only goes down by the odd page when they do, so its
+// current usage is also its peak, near enough. The Callstack is counted by depth, which does shrink, so its peak is
+// kept track of as calls push it deeper.
+
+#include "global.h"
+#include "paged.h"
+
+#define QUOTA_DEFAULTS { /* No limits */ \
+    .memory_limit = UINT64_MAX, \
+    .callstack_limit = UINT64_MAX, \
+    .callstack_peak = 0 \
+}
+
+extern FVMR_VM_STATE struct fvmr_quota { // Limits on the VM's memory, and how much of it it has used
+    uint64_t memory_limit, // Cells of Main Memory it may use, counting paged memory by the page (UINT64_MAX for no limit)
+             callstack_limit, // Cells of Callstack it may use, whether pushed by cl or written to by st (UINT64_MAX for no limit)
+             callstack_peak; // Deepest the Callstack has been
+} quota;
+
+struct fvmr_usage { // How much memory a VM is using
+    uint64_t memory, // Cells of Main Memory in use, counting paged memory by the page (which hardly ever goes down, so this is also its peak, near enough)
+             paged, // Cells of that which are paged memory
+             callstack, // Cells on the Callstack now
+             callstack_peak; // Cells on the Callstack at its deepest
+};
+
+extern void quota_init(uint64_t memory, uint64_t callstack); // Set the limits for the VM running on this thread, with UINT64_MAX for no limit on either
+extern _Bool quota_memory_exceeded(uint64_t address); // If a store to address, at or past the end of Main Memory, would take it past its limit (without reporting it)
+extern _Bool quota_memory_exceeded_by(const struct fvm_file *memory, const struct fvmr_paged *pages, const struct fvmr_quota *limits, uint64_t address); // quota_memory_exceeded() for a VM with the given Main Memory, paged memory and quota
+extern _Bool quota_memory(uint64_t address); // Check that a store to address, at or past the end of Main Memory, keeps it within its limit. Returns 1 (having reported it) if it wouldn't
+extern _Bool quota_memory_by(const struct fvm_file *memory, const struct fvmr_paged *pages, const struct fvmr_quota *limits, uint64_t address); // quota_memory() for a VM with the given Main Memory, paged memory and quota, which needn't be the one running on this thread
+extern _Bool quota_callstack(uint64_t address); // Check that address is within the Callstack's limit, returns 1 (having reported it) if it isn't
+extern void quota_usage(const struct fvm_file *memory, const struct fvmr_paged *pages, const struct fvm_file *callstack, const struct fvmr_quota *limits, struct fvmr_usage *usage); // Fill usage for a VM with the given Main Memory, paged memory, Callstack and quota
+extern void quota_report(void); // Print how much memory was used, against any limits
+
+static inline _Bool quota_push(void) { // Make room for a cl to push onto the Callstack, counting it towards the peak, returns 1 (having reported why) if there isn't
+    if(files[CST].length >= quota.callstack_peak && quota_callstack(files[CST].length)) // Only a call deeper than any before it can go past the limit
+        return 1;
+
+    if(file_reserve(&files[CST], files[CST].length)) { // Grow the callstack if it needs to include the address of this call
+        perror("fvmr -> Failure reallocating memory for Callstack");
+
+        return 1;
+    }
+
+    if(++files[CST].length > quota.callstack_peak) // Only counted once the cell is there, so that a failed call leaves the Callstack and its peak as they were
+        quota.callstack_peak = files[CST].length;
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,429 @@
+/* Fox Virtual Machine: Batch Scheduler
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// Guests are spread over the workers' queues up front. A worker runs the guest at the front of its own queue for one
+// quantum and puts it back on the end if it hasn't stopped, so that its guests take turns. A worker whose queue is empty
+// steals from the back of another's, so that the load stays even as guests finish at different times. The queues each
+// have their own lock, which is only ever contended by a steal, and is held for a few instructions at a time. A worker
+// that finds nothing to run or steal (every guest left being run by another) sleeps until one is queued again or the
+// last one stops, rather than spinning on the queues.
+
+#include "scheduler.h"
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+struct fvmr_scheduler scheduler = {
+    .guests = NULL,
+    .length = 0,
+    .size = 0,
+    .no_workers = 0,
+    .workers = NULL,
+    .max_memory = UINT64_MAX,
+    .max_callstack = UINT64_MAX,
+    .failed = 0,
+    .queued = 0,
+    .idle_lock = PTHREAD_MUTEX_INITIALIZER,
+    .idle = PTHREAD_COND_INITIALIZER
+};
+
+static uint64_t *scheduler_load_rom(const char *path, uint64_t *length) { // Read the ROM at path into a new buffer of *length cells, returns NULL (having reported why) on failure
+    FILE *f;
+    uint64_t *image;
+
+    if((f = fopen(path, "rb")) == NULL) {
+        fprintf(stderr, "fvmr -> Could not access ROM '%s': ", path);
+        perror(NULL);
+
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+
+    *length = ftell(f);
+    *length = (*length >> 3) + (_Bool)(*length % 8);
+
+    rewind(f);
+
+    if((image = calloc(*length ? *length : 1, sizeof(uint64_t))) == NULL) {
+        perror("fvmr -> Could not allocate memory for ROM");
+
+        fclose(f);
+
+        return NULL;
+    }
+
+    fread(image, *length, sizeof(uint64_t), f);
+
+    fclose(f);
+
+    return image;
+}
+
+static _Bool scheduler_add(char *rom, char *input, char *output) { // Make a guest running the ROM at rom with the given console, returns 1 on failure
+    struct scheduler_guest *guest;
+    uint64_t *image,
+             length;
+
+    if(scheduler.length == scheduler.size) {
+        if((alloc_buff = realloc(scheduler.guests, (scheduler.size + ALLOC_SIZE) * sizeof(struct scheduler_guest))) == NULL) {
+            perror("fvmr -> Could not allocate memory for batch");
+
+            return 1;
+        }
+
+        scheduler.guests = (struct scheduler_guest *)alloc_buff;
+        scheduler.size += ALLOC_SIZE;
+    }
+
+    guest = &scheduler.guests[scheduler.length];
+
+    *guest = (struct scheduler_guest){
+        .rom = strdup(rom),
+        .input = input != NULL ? strdup(input) : NULL,
+        .output = output != NULL ? strdup(output) : NULL,
+        .console_input = NULL,
+        .console_output = NULL,
+        .vm = NULL,
+        .status = FVM_VM_PAUSED,
+        .quanta = 0,
+        .seconds = 0
+    };
+
+    scheduler.length++; // Counted straight away, so that scheduler_end() cleans it up whatever fails below
+
+    if(guest->rom == NULL || (input != NULL && guest->input == NULL) || (output != NULL && guest->output == NULL)) {
+        perror("fvmr -> Could not allocate memory for batch");
+
+        return 1;
+    }
+
+    if(input != NULL && (guest->console_input = fopen(input, "rb")) == NULL) {
+        fprintf(stderr, "fvmr -> Could not access input '%s': ", input);
+        perror(NULL);
+
+        return 1;
+    }
+
+    if(output != NULL && (guest->console_output = fopen(output, "wb")) == NULL) {
+        fprintf(stderr, "fvmr -> Could not access output '%s': ", output);
+        perror(NULL);
+
+        return 1;
+    }
+
+    if((image = scheduler_load_rom(rom, &length)) == NULL)
+        return 1;
+
+    guest->vm = fvm_vm_create(image, length, NULL);
+
+    free(image);
+
+    if(guest->vm == NULL)
+        return 1;
+
+    fvm_vm_set_console(guest->vm, guest->console_input, guest->console_output);
+    fvm_vm_set_limits(guest->vm, scheduler.max_memory, scheduler.max_callstack);
+
+    return 0;
+}
+
+_Bool scheduler_init(const char *batch, uint64_t max_memory, uint64_t max_callstack) { // Read the batch file and make its guests
+    FILE *f;
+    char line[4096],
+         *fields[4];
+    uint64_t line_no = 0,
+             no_fields;
+
+    scheduler.max_memory = max_memory;
+    scheduler.max_callstack = max_callstack;
+
+    if((f = fopen(batch, "r")) == NULL) {
+        perror("fvmr -> Could not access batch file");
+
+        return 1;
+    }
+
+    while(fgets(line, sizeof(line), f) != NULL) {
+        line_no++;
+
+        if(!(no_fields = line_fields(line, fields, 4))) // Blank line or comment
+            continue;
+
+        if(no_fields > 3) {
+            fprintf(stderr, "fvmr -> Expected '<rom> [<input> [<output>]]' on line %zu of batch file\n", line_no);
+
+            fclose(f);
+
+            return 1;
+        }
+
+        if(scheduler_add(fields[0], no_fields > 1 ? fields[1] : NULL, no_fields > 2 ? fields[2] : NULL)) {
+            fprintf(stderr, "fvmr -> Could not set up the guest on line %zu of batch file\n", line_no);
+
+            fclose(f);
+
+            return 1;
+        }
+    }
+
+    fclose(f);
+
+    if(!scheduler.length) {
+        fprintf(stderr, "fvmr -> Found batch file to be empty!\n");
+
+        return 1;
+    }
+
+    return 0;
+}
+
+static void scheduler_wake(_Bool all) { // Wake one worker waiting on scheduler.idle (or all of them)
+    pthread_mutex_lock(&scheduler.idle_lock); // So that a worker between checking and waiting can't miss it
+
+    if(all)
+        pthread_cond_broadcast(&scheduler.idle);
+    else
+        pthread_cond_signal(&scheduler.idle);
+
+    pthread_mutex_unlock(&scheduler.idle_lock);
+}
+
+static void scheduler_push(struct scheduler_deque *deque, uint64_t guest) { // Put guest on the back of deque
+    uint64_t count;
+
+    pthread_mutex_lock(&deque->lock);
+
+    deque->ring[(deque->head + deque->count++) % scheduler.length] = guest;
+
+    count = deque->count;
+
+    pthread_mutex_unlock(&deque->lock);
+
+    atomic_fetch_add(&scheduler.queued, 1);
+
+    if(count > 1) // For a worker with nothing to do to steal it (not when it's the only one, which the worker requeueing it runs next, so that a worker woken for it would only move it between threads)
+        scheduler_wake(0);
+}
+
+static _Bool scheduler_take(struct scheduler_deque *deque, _Bool back, uint64_t *guest) { // Take a guest from the front (or back) of deque into *guest, returns 1 if it was empty
+    _Bool empty;
+
+    pthread_mutex_lock(&deque->lock);
+
+    if(!(empty = !deque->count)) {
+        if(back) {
+            *guest = deque->ring[(deque->head + deque->count - 1) % scheduler.length];
+        } else {
+            *guest = deque->ring[deque->head];
+            deque->head = (deque->head + 1) % scheduler.length;
+        }
+
+        deque->count--;
+
+        atomic_fetch_sub(&scheduler.queued, 1);
+    }
+
+    pthread_mutex_unlock(&deque->lock);
+
+    return empty;
+}
+
+static _Bool scheduler_steal(struct scheduler_worker *thief, uint64_t *guest) { // Take a guest from the back of another worker's queue, returns 1 if they were all empty
+    for(uint64_t i = 1; i < scheduler.no_workers; i++) { // Starting from the next worker along, so that thieves don't all go for the same one
+        if(!scheduler_take(&scheduler.workers[(thief->index + i) % scheduler.no_workers].deque, 1, guest)) {
+            thief->steals++;
+
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static void *scheduler_work(void *arg) { // Body of a worker thread
+    struct scheduler_worker *worker = arg;
+    struct scheduler_guest *guest;
+    struct timespec start;
+    uint64_t index;
+
+    while(atomic_load(&scheduler.remaining)) {
+        if(scheduler_take(&worker->deque, 0, &index) && scheduler_steal(worker, &index)) { // Every guest left is being run by another worker
+            pthread_mutex_lock(&scheduler.idle_lock);
+
+            while(atomic_load(&scheduler.remaining) && !atomic_load(&scheduler.queued))
+                pthread_cond_wait(&scheduler.idle, &scheduler.idle_lock);
+
+            pthread_mutex_unlock(&scheduler.idle_lock);
+
+            continue;
+        }
+
+        guest = &scheduler.guests[index];
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        guest->status = fvm_vm_run(guest->vm, scheduler.quantum);
+
+        guest->seconds += elapsed(&start);
+        guest->quanta++;
+        worker->quanta++;
+
+        if(guest->status == FVM_VM_PAUSED) // Preempted, so it goes to the back of the queue
+            scheduler_push(&worker->deque, index);
+        else if(atomic_fetch_sub(&scheduler.remaining, 1) == 1) // The last one, so any waiting workers are done
+            scheduler_wake(1);
+    }
+
+    return NULL;
+}
+
+_Bool scheduler_run(uint64_t workers, uint64_t quantum) { // Run every guest to completion
+    struct timespec start;
+    long online;
+    uint64_t started;
+
+    if(!workers)
+        workers = (online = sysconf(_SC_NPROCESSORS_ONLN)) > 0 ? (uint64_t)online : 1;
+
+    if(workers > scheduler.length) // Any more would have nothing to do
+        workers = scheduler.length;
+
+    if((scheduler.workers = calloc(workers, sizeof(struct scheduler_worker))) == NULL) {
+        perror("fvmr -> Could not allocate memory for workers");
+
+        return 1;
+    }
+
+    scheduler.quantum = quantum;
+
+    for(; scheduler.no_workers < workers; scheduler.no_workers++) {
+        scheduler.workers[scheduler.no_workers].index = scheduler.no_workers;
+
+        if((scheduler.workers[scheduler.no_workers].deque.ring = calloc(scheduler.length, sizeof(uint64_t))) == NULL) {
+            perror("fvmr -> Could not allocate memory for workers");
+
+            return 1;
+        }
+
+        pthread_mutex_init(&scheduler.workers[scheduler.no_workers].deque.lock, NULL);
+    }
+
+    for(uint64_t i = 0; i < scheduler.length; i++) // Deal the guests out between the workers
+        scheduler_push(&scheduler.workers[i % workers].deque, i);
+
+    atomic_store(&scheduler.remaining, scheduler.length);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for(started = 0; started < workers; started++) {
+        if(pthread_create(&scheduler.workers[started].thread, NULL, scheduler_work, &scheduler.workers[started])) {
+            fprintf(stderr, "fvmr -> Could not start worker %zu\n", started);
+
+            break;
+        }
+    }
+
+    if(!started) // Otherwise the ones that did start steal the guests queued for the ones that didn't
+        return 1;
+
+    for(uint64_t i = 0; i < started; i++)
+        pthread_join(scheduler.workers[i].thread, NULL);
+
+    scheduler.seconds = elapsed(&start);
+
+    for(uint64_t i = 0; i < scheduler.length; i++)
+        scheduler.failed += scheduler.guests[i].status == FVM_VM_FAILED;
+
+    return 0;
+}
+
+void scheduler_report(void) { // Print each guest's exit code and stats, and the totals
+    struct fvmr_usage usage;
+    uint64_t instructions = 0,
+             steals = 0;
+
+    for(uint64_t i = 0; i < scheduler.length; i++) { // Tracebacks first, so that the summary is all together at the end
+        if(scheduler.guests[i].status == FVM_VM_FAILED) {
+            fprintf(stderr, "fvmr -> Guest %zu (%s) failed with exit code %d\n", i, scheduler.guests[i].rom, fvm_vm_exit_code(scheduler.guests[i].vm));
+
+            fvm_vm_traceback(scheduler.guests[i].vm);
+        }
+    }
+
+    fprintf(stderr,
+            "fvmr -> Batch:\n"
+            "\tGuest\tExit code\tInstructions\tQuanta\tTime\tMemory\tCallstack\tROM\n");
+
+    for(uint64_t i = 0; i < scheduler.length; i++) {
+        instructions += scheduler.guests[i].vm->stats.instructions;
+
+        fvm_vm_usage(scheduler.guests[i].vm, &usage);
+
+        fprintf(stderr,
+                "\t%zu\t%d\t%zu\t%zu\t%.6fs\t%zu\t%zu\t%s\n",
+                i,
+                fvm_vm_exit_code(scheduler.guests[i].vm),
+                scheduler.guests[i].vm->stats.instructions,
+                scheduler.guests[i].quanta,
+                scheduler.guests[i].seconds,
+                usage.memory,
+                usage.callstack_peak,
+                scheduler.guests[i].rom);
+    }
+
+    for(uint64_t i = 0; i < scheduler.no_workers; i++)
+        steals += scheduler.workers[i].steals;
+
+    fprintf(stderr,
+            "\tGuests: %zu (%zu failed)\n"
+            "\tWorkers: %zu\n"
+            "\tQuantum: %zu instructions\n"
+            "\tSteals: %zu\n"
+            "\tInstructions executed: %zu\n"
+            "\tTime: %.6fs\n"
+            "\tMIPS: %.2f\n",
+            scheduler.length,
+            scheduler.failed,
+            scheduler.no_workers,
+            scheduler.quantum,
+            steals,
+            instructions,
+            scheduler.seconds,
+            scheduler.seconds > 0 ? (double)instructions / scheduler.seconds / 1e6 : 0);
+}
+
+void scheduler_end(void) { // Cleanup
+    for(uint64_t i = 0; i < scheduler.length; i++) {
+        fvm_vm_destroy(scheduler.guests[i].vm);
+
+        if(scheduler.guests[i].console_input != NULL)
+            fclose(scheduler.guests[i].console_input);
+
+        if(scheduler.guests[i].console_output != NULL)
+            fclose(scheduler.guests[i].console_output);
+
+        free(scheduler.guests[i].rom);
+        free(scheduler.guests[i].input);
+        free(scheduler.guests[i].output);
+    }
+
+    for(uint64_t i = 0; i < scheduler.no_workers; i++) {
+        free(scheduler.workers[i].deque.ring);
+
+        pthread_mutex_destroy(&scheduler.workers[i].deque.lock);
+    }
+
+    free(scheduler.guests);
+    free(scheduler.workers);
+
+    scheduler.guests = NULL;
+    scheduler.workers = NULL;
+    scheduler.length = scheduler.size = scheduler.no_workers = 0;
+}
@@ -0,0 +1,64 @@
+#ifndef FVMR_SCHEDULER_H
+
+#define FVMR_SCHEDULER_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "global.h"
+#include "vm.h"
+
+#define SCHEDULER_QUANTUM 100000 // Instructions a guest runs for before it's preempted, unless --quantum= says otherwise
+
+// Batch files have one guest per line, as "<rom> [<input> [<output>]]", where input and output are files for its console
+// (with nothing to read and its output discarded when left out). Blank lines and lines starting with '#' are skipped.
+
+struct scheduler_guest { // One guest from the batch file
+    char *rom, // Paths from the batch file (input and output are NULL when left out)
+         *input,
+         *output;
+    FILE *console_input, // Its console
+         *console_output;
+    struct fvm_vm *vm;
+    enum fvm_vm_status status; // What it stopped for at the end of its last quantum
+    uint64_t quanta; // Number of quanta it has been given
+    double seconds; // Wall-clock time spent running it
+};
+
+struct scheduler_deque { // A worker's run queue of indices into scheduler.guests, which it takes from the front of and requeues preempted guests on the back of, while other workers steal from the back
+    pthread_mutex_t lock;
+    uint64_t *ring, // Holds up to scheduler.length guests, since a guest is only ever in one queue
+             head, // Index in ring of the front
+             count; // Number of guests queued
+};
+
+struct scheduler_worker { // One worker thread
+    pthread_t thread;
+    struct scheduler_deque deque;
+    uint64_t index, // Position in scheduler.workers
+             quanta, // Number of quanta it has run
+             steals; // Number of guests it took from other workers
+};
+
+extern struct fvmr_scheduler { // Runs a batch of guests on a pool of worker threads, preempting them every quantum
+    struct scheduler_guest *guests;
+    uint64_t length, // Number of guests
+             size, // Number allocated for
+             no_workers,
+             quantum,
+             max_memory, // Limits on each guest's memory (UINT64_MAX for none)
+             max_callstack,
+             failed; // Number of guests that stopped with an error
+    struct scheduler_worker *workers;
+    _Atomic uint64_t remaining, // Number of guests yet to finish or fail, which the workers stop at once it reaches 0
+                     queued; // Number of guests in the workers' queues, so that one with nothing to do knows whether it's worth looking for any
+    pthread_mutex_t idle_lock; // Held while checking whether to wait on idle
+    pthread_cond_t idle; // Signalled when a guest is queued or the last one stops, for workers that had nothing to run or steal
+    double seconds; // Wall-clock time for the whole batch
+} scheduler;
+
+extern _Bool scheduler_init(const char *batch, uint64_t max_memory, uint64_t max_callstack); // Read the batch file and make a VM for each of its guests, each limited to max_memory cells of Main Memory and max_callstack cells of Callstack (UINT64_MAX for no limit), returns 1 on failure
+extern _Bool scheduler_run(uint64_t workers, uint64_t quantum); // Run every guest to completion on workers threads (or one per online CPU if 0), returns 1 if the workers could not be started
+extern void scheduler_report(void); // Print each guest's exit code and stats, and the totals
+extern void scheduler_end(void); // Cleanup
+
+#endif
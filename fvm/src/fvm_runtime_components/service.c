@@ -0,0 +1,61 @@
+/* Fox Virtual Machine: Engine Services
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "service.h"
+#include "budget.h"
+#include "checkpoint.h"
+#include "fvmgl.h"
+#include "fvmkbd.h"
+
+struct fvmr_service service = {
+    .due = UINT64_MAX
+};
+
+void service_interrupt(void) { // Have service_run() called at the next chance
+    atomic_store_explicit(&service.due, 0, memory_order_relaxed);
+}
+
+void service_schedule(void) { // Bring service.due forward
+    uint64_t next = checkpoint.next < budget.instructions ? checkpoint.next : budget.instructions,
+             current = atomic_load(&service.due);
+
+    if(fvmgl_polling.next < next)
+        next = fvmgl_polling.next;
+
+    while(next < current && !atomic_compare_exchange_weak(&service.due, &current, next)); // Never pushed back, so that an interrupt isn't lost
+}
+
+_Bool service_run(uint64_t cea, uint64_t executed) { // Poll for window events, check the budget and take any checkpoint that is due
+    atomic_store(&service.due, UINT64_MAX); // Before anything is checked, so that an interrupt from here on is seen next time
+
+    if(fvmgl_tick(executed)) {
+        fprintf(stderr, "fvmr -> Graphics library encountered an error.\n");
+
+        fvmr_exit_code = FVMR_EXIT_FAILURE_GRAPHICS_LIB;
+
+        return 1;
+    }
+
+    if(fvmkbd_tick()) {
+        fprintf(stderr, "fvmr -> Keyboard library encountered an error.\n");
+
+        fvmr_exit_code = FVMR_EXIT_FAILURE_KEYBOARD_LIB;
+
+        return 1;
+    }
+
+    if(budget_exhausted(executed))
+        return 1;
+
+    if(atomic_exchange(&checkpoint.requested, 0) || executed >= checkpoint.next)
+        checkpoint_take(cea, executed);
+
+    service_schedule();
+
+    return 0;
+}
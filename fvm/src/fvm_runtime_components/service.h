@@ -0,0 +1,21 @@
+#ifndef FVMR_SERVICE_H
+
+#define FVMR_SERVICE_H
+
+#include <stdatomic.h>
+#include "global.h"
+
+// Work done between instructions (polling for window events, checking the budget and taking checkpoints), which the
+// engines check for once per block or jump (or per instruction, on the table engine), but only do when SERVICE_DUE() says so.
+
+extern struct fvmr_service {
+    _Atomic uint64_t due; // Instructions into the run when service_run() next has to be called (0 to call it at the next chance, UINT64_MAX if never)
+} service;
+
+#define SERVICE_DUE(executed) (atomic_load_explicit(&service.due, memory_order_relaxed) <= (executed)) // If an engine that has run executed instructions should call service_run()
+
+extern void service_interrupt(void); // Have service_run() called at the next chance (safe to call from a signal handler)
+extern void service_schedule(void); // Bring service.due forward to the soonest point that a poll, a checkpoint or the budget is due
+extern _Bool service_run(uint64_t cea, uint64_t executed); // Poll for window events, check the budget and take any checkpoint that is due, with cea as the instruction to carry on from, once an engine has written its registers back to fvm_registers. Returns 1 (setting fvmr_exit_code) if the VM has to stop
+
+#endif
@@ -0,0 +1,98 @@
+/* Fox Virtual Machine: Threaded Dispatch Engine
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// This engine runs the decoded form of Main Memory (see decoder.c), with every handler inlined into threaded_run(), and each
+// handler ending with its own jump to the next one, so that the host can predict each transition separately instead of
+// sharing one indirect call for all of them. CEA, ACC and DAT live in locals, and are only written back to fvm_registers
+// once execution stops. Since the decoder has already checked every operand, the handlers don't check anything that can't
+// change at runtime. The handlers themselves are shared with the block engine (see handlers.h).
+
+#include "threaded.h"
+
+#define HANDLER(op) THREADED_HANDLER(op)
+#define HANDLER_SLOT code[cea]
+#define HANDLER_NEXT() THREADED_NEXT()
+#define HANDLER_EXIT(taken) THREADED_NEXT() // Successors are dispatched from the decoded stream like anything else
+#define HANDLER_EXIT_DYNAMIC() do { THREADED_CHECK_TARGET(); THREADED_NEXT(); } while(0)
+#define HANDLER_WRITTEN(address) decoder_invalidate(address)
+#define HANDLER_RELOAD() do { mem = files[MEM].self; code = decoder.code; } while(0)
+
+#ifdef FVMR_COMPUTED_GOTO
+#define THREADED_HANDLER(op) handler_##op
+#define THREADED_DISPATCH() goto *handlers[code[cea].op]
+#else
+#define THREADED_HANDLER(op) case op
+#define THREADED_DISPATCH() goto dispatch
+#endif
+
+// The tail of each handler counts the instruction, does anything from service_run() that is due, steps over its last cell and dispatches:
+
+#define THREADED_NEXT() do { \
+        executed++; \
+        \
+        if(SERVICE_DUE(executed)) { \
+            fvm_registers[ACC] = acc; \
+            fvm_registers[DAT] = dat; \
+            \
+            if(service_run(cea + 1, executed)) \
+                goto end; \
+        } \
+        \
+        cea++; \
+        \
+        THREADED_DISPATCH(); \
+    } while(0)
+
+#define THREADED_CHECK_TARGET() do { /* After a jump that couldn't be checked by the decoder, make sure there's a slot to dispatch */ \
+        if(cea + 1 >= decoder.length) { \
+            cea++; \
+            \
+            goto undecoded; \
+        } \
+    } while(0)
+
+void threaded_run(void) { // Execute with the threaded engine
+    uint64_t *mem = files[MEM].self, // Main Memory, reloaded after anything that could have reallocated it
+             cea = fvm_registers[CEA], // 0 at boot, or wherever a fork server's snapshot was taken
+             acc = fvm_registers[ACC],
+             dat = fvm_registers[DAT],
+             value,
+             executed = 0;
+    struct decoded_instruction *code = decoder.code; // Decoded Main Memory, reloaded alongside mem
+
+#ifdef FVMR_COMPUTED_GOTO
+    static const void *handlers[NO_DECODED_OPS] = {
+        [DECODED_UNDECODED] = &&handler_DECODED_UNDECODED,
+        HANDLER_LABELS
+    };
+
+    THREADED_DISPATCH();
+#else
+dispatch:
+    switch(code[cea].op) {
+#endif
+    THREADED_HANDLER(DECODED_UNDECODED): // Not decoded yet, or modified since
+undecoded:
+        if(decoder_decode(cea, DECODER_RUNNING))
+            goto execution_error;
+
+        THREADED_DISPATCH();
+#include "handler_bodies.h"
+#ifndef FVMR_COMPUTED_GOTO
+    }
+#endif
+
+execution_error:
+    fvmr_exit_code = FVMR_EXIT_FAILURE_EXECUTION;
+end: // Write the registers held in locals back for the traceback and anything run afterwards
+    fvm_registers[CEA] = cea;
+    fvm_registers[ACC] = acc;
+    fvm_registers[DAT] = dat;
+
+    fvmr_stats.instructions += executed;
+}
@@ -0,0 +1,11 @@
+#ifndef FVMR_THREADED_H
+
+#define FVMR_THREADED_H
+
+#include "global.h"
+#include "instructions.h"
+#include "handlers.h"
+
+extern void threaded_run(void); // Execute from CEA with the threaded engine until fi or an error, setting fvmr_exit_code
+
+#endif
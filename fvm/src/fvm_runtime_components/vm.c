@@ -0,0 +1,195 @@
+/* Fox Virtual Machine: Embedding API
+ * Copyright (C) 2025 Finn Chipp
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// The engines reach the running VM's state through globals at fixed addresses (the jit engine bakes them into its
+// translations), so rather than threading a context pointer through every handler, the globals are this thread's working
+// set, and a VM's state is copied in before it runs and out again afterwards, much like a context switch.
+
+#include "vm.h"
+#include "pinned.h"
+
+static void fvm_vm_enter(const struct fvm_vm *vm) { // Swap vm's state into the globals for this thread
+    memcpy(fvm_registers, vm->registers, sizeof(fvm_registers));
+    memcpy(files, vm->files, sizeof(files));
+
+    paged = vm->paged;
+    quota = vm->quota;
+    heap = vm->heap;
+
+    disk = vm->disk;
+    console_input = vm->input;
+    console_output = vm->output;
+    fvmr_exit_code = vm->exit_code;
+    fvmr_stats = vm->stats;
+    fvmgl_screen_object = vm->screen;
+    fvmkbd = vm->keyboard;
+}
+
+static void fvm_vm_leave(struct fvm_vm *vm) { // Swap the globals for this thread back out into vm
+    memcpy(vm->registers, fvm_registers, sizeof(fvm_registers));
+    memcpy(vm->files, files, sizeof(files));
+
+    vm->paged = paged;
+    vm->quota = quota;
+    vm->heap = heap;
+
+    vm->disk = disk;
+    vm->input = console_input;
+    vm->output = console_output;
+    vm->exit_code = fvmr_exit_code;
+    vm->stats = fvmr_stats;
+    vm->screen = fvmgl_screen_object;
+    vm->keyboard = fvmkbd;
+}
+
+struct fvm_vm *fvm_vm_create(const uint64_t *image, uint64_t length, const char *disk_path) { // Make a VM running a copy of image
+    struct fvm_vm *vm;
+
+    if(!length) {
+        fprintf(stderr, "fvmr -> Found ROM to be empty!\n");
+
+        return NULL;
+    }
+
+    if((vm = calloc(1, sizeof(struct fvm_vm))) == NULL) {
+        perror("fvmr -> Could not allocate memory for VM");
+
+        return NULL;
+    }
+
+    vm->screen = (struct fvmgl_screen)FVMGL_SCREEN_DEFAULTS;
+    vm->paged = (struct fvmr_paged)PAGED_DEFAULTS;
+    vm->quota = (struct fvmr_quota)QUOTA_DEFAULTS;
+    vm->heap = (struct fvmr_heap)HEAP_DEFAULTS;
+    vm->input = stdin;
+    vm->output = stdout;
+
+    if((vm->files[CST] = (struct fvm_file){.self = calloc(ALLOC_SIZE, sizeof(uint64_t)), .size = ALLOC_SIZE, .length = 0}).self == NULL) {
+        perror("fvmr -> Could not allocate memory for Callstack");
+
+        free(vm);
+
+        return NULL;
+    }
+
+    if((vm->files[MEM] = (struct fvm_file){.self = calloc(length, sizeof(uint64_t)), .size = length, .length = length}).self == NULL) {
+        perror("fvmr -> Could not allocate memory for Main Memory");
+
+        free(vm->files[CST].self);
+        free(vm);
+
+        return NULL;
+    }
+
+    memcpy(vm->files[MEM].self, image, length * sizeof(uint64_t));
+
+    if(disk_path != NULL && (vm->disk = fopen(disk_path, "rb+")) == NULL) {
+        perror("fvmr -> Could not access Disk");
+
+        free(vm->files[CST].self);
+        free(vm->files[MEM].self);
+        free(vm);
+
+        return NULL;
+    }
+
+    return vm;
+}
+
+void fvm_vm_set_console(struct fvm_vm *vm, FILE *input, FILE *output) { // Redirect the console
+    vm->input = input;
+    vm->output = output;
+}
+
+void fvm_vm_set_limits(struct fvm_vm *vm, uint64_t memory, uint64_t callstack) { // Limit the memory vm may use
+    vm->quota.memory_limit = memory;
+    vm->quota.callstack_limit = callstack;
+}
+
+void fvm_vm_usage(const struct fvm_vm *vm, struct fvmr_usage *usage) { // How much memory vm is using
+    quota_usage(&vm->files[MEM], &vm->paged, &vm->files[CST], &vm->quota, usage);
+}
+
+enum fvm_vm_status fvm_vm_run(struct fvm_vm *vm, uint64_t steps) { // Run at most steps instructions of vm
+    _Bool exhausted;
+
+    if(!vm->stopped) {
+        fvm_vm_enter(vm);
+
+        exhausted = pinned_run(steps);
+
+        fvm_vm_leave(vm);
+
+        if(exhausted)
+            return FVM_VM_PAUSED;
+
+        vm->stopped = 1;
+    }
+
+    return vm->exit_code == FVMR_EXIT_SUCCESS ? FVM_VM_FINISHED : FVM_VM_FAILED;
+}
+
+uint64_t fvm_vm_get_register(const struct fvm_vm *vm, enum fvm_register reg) { // Value of reg
+    return vm->registers[reg];
+}
+
+void fvm_vm_set_register(struct fvm_vm *vm, enum fvm_register reg, uint64_t value) { // Set reg
+    vm->registers[reg] = value;
+}
+
+uint64_t fvm_vm_memory_length(const struct fvm_vm *vm) { // Number of cells in Main Memory
+    return vm->files[MEM].length;
+}
+
+_Bool fvm_vm_read(const struct fvm_vm *vm, uint64_t address, uint64_t *value) { // Read the cell at address
+    *value = address < vm->files[MEM].length ? vm->files[MEM].self[address] : paged_load(&vm->paged, address);
+
+    return 0;
+}
+
+_Bool fvm_vm_write(struct fvm_vm *vm, uint64_t address, uint64_t value) { // Write value to the cell at address
+    if(address < vm->files[MEM].length) {
+        vm->files[MEM].self[address] = value;
+    } else if(quota_memory_by(&vm->files[MEM], &vm->paged, &vm->quota, address)) { // Refused past its limit, as st would be
+        return 1;
+    } else if(paged_store(&vm->files[MEM], &vm->paged, address, value)) { // Grow Main Memory to fit it, or page it, as st would
+        perror("fvmr -> Failure accessing memory at specified address");
+
+        return 1;
+    }
+
+    return 0;
+}
+
+enum fvmr_exit_code_value fvm_vm_exit_code(const struct fvm_vm *vm) { // What the VM would exit with as fvmr
+    return vm->exit_code;
+}
+
+void fvm_vm_traceback(struct fvm_vm *vm) { // Print the VM's registers, Callstack and Main Memory
+    fvm_vm_enter(vm);
+
+    traceback();
+
+    fvm_vm_leave(vm);
+}
+
+void fvm_vm_destroy(struct fvm_vm *vm) { // Free the VM and close its disk
+    if(vm == NULL)
+        return;
+
+    free(vm->files[CST].self);
+    free(vm->files[MEM].self);
+    free(vm->keyboard.keypress_queue);
+
+    paged_end(&vm->paged);
+
+    if(vm->disk != NULL)
+        fclose(vm->disk);
+
+    free(vm);
+}
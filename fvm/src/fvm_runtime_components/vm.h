@@ -0,0 +1,53 @@
+#ifndef FVMR_VM_H
+
+#define FVMR_VM_H
+
+// Embedding API (libfvmr):
+// (Each VM holds everything marked FVMR_VM_STATE. Running a VM swaps its state into those globals for the calling thread,
+// runs it with the pinned engine, and swaps it back out, so that any number of VMs can live in one process, and different
+// threads can run different VMs at the same time. A VM is never run by two threads at once)
+
+#include "global.h"
+#include "fvmgl.h"
+#include "fvmkbd.h"
+#include "paged.h"
+#include "quota.h"
+#include "heap.h"
+
+enum fvm_vm_status { // What fvm_vm_run() stopped for
+    FVM_VM_PAUSED = 0, // The steps it was given ran out, so it can be run again from where it left off
+    FVM_VM_FINISHED = 1, // It reached fi
+    FVM_VM_FAILED = 2 // It stopped with an error (see fvm_vm_exit_code() and fvm_vm_traceback())
+};
+
+struct fvm_vm { // One guest
+    uint64_t registers[NO_REGISTERS];
+    struct fvm_file files[NO_FILES];
+    struct fvmr_paged paged; // Main Memory past the end of files[MEM]
+    struct fvmr_quota quota; // Limits on its memory, with no limits unless set with fvm_vm_set_limits()
+    struct fvmr_heap heap; // Its heap allocator's free lists, in Main Memory
+    FILE *disk; // NULL if the VM was made without one, in which case the disk can't be used
+    FILE *input, // The console, which is stdin and stdout unless set otherwise with fvm_vm_set_console()
+         *output;
+    enum fvmr_exit_code_value exit_code;
+    struct fvmr_stats stats;
+    struct fvmgl_screen screen; // Never initialised, so the screen buffer can't be used
+    struct fvmkbd_data keyboard; // Never has keypresses, since there is no window to get them from
+    _Bool stopped; // If it has finished or failed, so that running it again does nothing
+};
+
+extern struct fvm_vm *fvm_vm_create(const uint64_t *image, uint64_t length, const char *disk_path); // Make a VM whose Main Memory is a copy of the length cells at image, with the file at disk_path (or none, if NULL) as its disk. Returns NULL (having reported why) on failure
+extern void fvm_vm_set_console(struct fvm_vm *vm, FILE *input, FILE *output); // Have MAR 0 on INP/OUT read from input and write to output instead of stdin and stdout (NULL for nothing to read or write). They stay owned by the caller
+extern void fvm_vm_set_limits(struct fvm_vm *vm, uint64_t memory, uint64_t callstack); // Limit the cells of Main Memory (counting paged memory by the page) and Callstack that vm may use, with UINT64_MAX for no limit. A st or cl that would go past one fails, stopping it with FVM_VM_FAILED, and so does fvm_vm_write() (returning 1)
+extern void fvm_vm_usage(const struct fvm_vm *vm, struct fvmr_usage *usage); // Fill usage with how much memory vm is using now, and at most so far
+extern enum fvm_vm_status fvm_vm_run(struct fvm_vm *vm, uint64_t steps); // Run at most steps instructions of vm
+extern uint64_t fvm_vm_get_register(const struct fvm_vm *vm, enum fvm_register reg); // Value of reg, which has to be below NO_REGISTERS
+extern void fvm_vm_set_register(struct fvm_vm *vm, enum fvm_register reg, uint64_t value); // Set reg, which has to be below NO_REGISTERS
+extern uint64_t fvm_vm_memory_length(const struct fvm_vm *vm); // Number of cells in the contiguous part of Main Memory, not counting any paged memory past it
+extern _Bool fvm_vm_read(const struct fvm_vm *vm, uint64_t address, uint64_t *value); // Read the cell at address into *value (0 if it was never written to). Every address is in Main Memory, so it always returns 0
+extern _Bool fvm_vm_write(struct fvm_vm *vm, uint64_t address, uint64_t value); // Write value to the cell at address, growing Main Memory or writing it to paged memory as st would, within the limit from fvm_vm_set_limits(). Returns 1 (having reported why) on failure, including if it would go past that limit
+extern enum fvmr_exit_code_value fvm_vm_exit_code(const struct fvm_vm *vm); // What the VM would exit with as fvmr
+extern void fvm_vm_traceback(struct fvm_vm *vm); // Print the VM's registers, Callstack and Main Memory to stderr
+extern void fvm_vm_destroy(struct fvm_vm *vm); // Free the VM and close its disk
+
+#endif